@@ -0,0 +1,61 @@
+// 基准测试共用的输入分布：random sorted reverse sawtooth few_unique zipf
+
+#ifndef BENCH_DISTRIBUTIONS_HPP
+#define BENCH_DISTRIBUTIONS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+const char* const kDistributions[] = {"random", "sorted", "reverse", "sawtooth", "few_unique", "zipf"};
+
+// 按分布 dist 填满 arr，相同的 seed 得到相同的数据
+inline void Generate(const std::string& dist, std::vector<int>& arr, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    size_t n = arr.size();
+    if (dist == "random") {
+        for (int& v : arr) {
+            v = static_cast<int>(rng());
+        }
+    } else if (dist == "sorted") {
+        for (size_t i = 0; i < n; ++i) {
+            arr[i] = static_cast<int>(i);
+        }
+    } else if (dist == "reverse") {
+        for (size_t i = 0; i < n; ++i) {
+            arr[i] = static_cast<int>(n - i);
+        }
+    } else if (dist == "sawtooth") {
+        // 若干段升序，每段约 sqrt(n) 个
+        size_t period = std::max<size_t>(1, static_cast<size_t>(std::sqrt(n)));
+        for (size_t i = 0; i < n; ++i) {
+            arr[i] = static_cast<int>(i % period);
+        }
+    } else if (dist == "few_unique") {
+        for (int& v : arr) {
+            v = static_cast<int>(rng() % 16);
+        }
+    } else if (dist == "zipf") {
+        // 取值 1..m，取到 k 的概率与 1/k 成正比
+        size_t m = std::min<size_t>(n, 1 << 20);
+        std::vector<double> cdf(m);
+        double sum = 0;
+        for (size_t k = 0; k < m; ++k) {
+            sum += 1.0 / (k + 1);
+            cdf[k] = sum;
+        }
+        std::uniform_real_distribution<double> u(0, sum);
+        for (int& v : arr) {
+            v = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin()) + 1;
+        }
+        // 打乱值与编号的对应，避免小值恰好集中在一起
+        for (int& v : arr) {
+            v = static_cast<int>(static_cast<uint32_t>(v) * 2654435761u);
+        }
+    }
+}
+
+#endif // BENCH_DISTRIBUTIONS_HPP
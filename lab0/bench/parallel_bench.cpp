@@ -0,0 +1,122 @@
+// 并行排序的扩展性测试：对 1e5 到 1e9 个随机 int，分别用 1, 2, 4, ... 个线程调用 parallelSort，
+// 给出耗时、每个元素的纳秒数和相对单线程的加速比，以 JSON 输出到标准输出。
+//
+// 用法: parallel_bench [-t 最大线程数] [-n 最小规模] [-N 最大规模] [-r 重复次数] [-c cutoff]
+// 规模从 -n 开始每次乘 10 直到 -N。1e9 个 int 需要约 8GB 内存（数据加归并缓冲区）。
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../bubblesort.hpp"
+
+namespace {
+
+// 每次运行前重新生成同样的数据，不必为原始数据再保留一份
+void Fill(std::vector<int>& arr, uint64_t seed) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (int& v : arr) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        v = static_cast<int>(x >> 32);
+    }
+}
+
+bool IsSorted(const std::vector<int>& arr) {
+    for (size_t i = 1; i < arr.size(); ++i) {
+        if (arr[i] < arr[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t minSize = 100000;
+    size_t maxSize = 100000000;
+    int repeat = 3;
+    size_t cutoff = sorting::kParallelSortCutoff;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:N:r:c:")) != -1) {
+        switch (opt) {
+        case 't':
+            maxThreads = strtoul(optarg, nullptr, 10);
+            break;
+        case 'n':
+            minSize = strtod(optarg, nullptr);
+            break;
+        case 'N':
+            maxSize = strtod(optarg, nullptr);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'c':
+            cutoff = strtod(optarg, nullptr);
+            break;
+        default:
+            std::cerr << "usage: " << argv[0]
+                      << " [-t threads] [-n min] [-N max] [-r repeat] [-c cutoff]\n";
+            return 2;
+        }
+    }
+    if (maxThreads == 0 || minSize == 0 || maxSize < minSize || repeat < 1) {
+        std::cerr << "invalid arguments\n";
+        return 2;
+    }
+
+    std::vector<unsigned> threads;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threads.push_back(t);
+    }
+    threads.push_back(maxThreads);
+
+    bool ok = true;
+    bool first = true;
+    std::cout << "{\n  \"cutoff\": " << cutoff << ",\n  \"repeat\": " << repeat
+              << ",\n  \"results\": [\n";
+    for (size_t n = minSize; n <= maxSize; n *= 10) {
+        std::vector<int> arr(n);
+        double base = 0;
+        for (unsigned t : threads) {
+            // 线程池在同一线程数的多次运行之间复用
+            sorting::ThreadPool pool(t);
+            double best = 0;
+            bool sorted = true;
+            for (int i = 0; i < repeat; ++i) {
+                Fill(arr, n);
+                auto start = std::chrono::steady_clock::now();
+                parallelSort(arr, pool, cutoff);
+                double s = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+                if (i == 0 || s < best) {
+                    best = s;
+                }
+                sorted = sorted && IsSorted(arr);
+            }
+            if (t == 1) {
+                base = best;
+            }
+            ok = ok && sorted;
+            std::cout << (first ? "" : ",\n") << "    {\"size\": " << n
+                      << ", \"threads\": " << t << ", \"seconds\": " << best
+                      << ", \"ns_per_element\": " << best * 1e9 / n
+                      << ", \"speedup\": " << base / best
+                      << ", \"sorted\": " << (sorted ? "true" : "false") << "}";
+            std::cout.flush();
+            first = false;
+        }
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+    return ok ? 0 : 1;
+}
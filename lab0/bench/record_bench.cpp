@@ -0,0 +1,205 @@
+// record_sort.hpp 的正确性检查和基准测试。记录的负载是 std::unique_ptr，只能移动，
+// 里面保存记录原来的下标。对每种输入分布和规模检查：
+// - 按 std::less（整数键走基数排序）和 std::greater（走 pdqsort）排序的结果
+//   都与 std::stable_sort 相同，键相同的记录保持原来的先后顺序
+// - 使用调用者提供的 scratch 时，排序过程中没有分配堆内存
+// - scratch 比 record_sort_scratch_size(n) 少一个元素时返回 false，记录不变
+// 并与 std::stable_sort 对比计时。结果以 JSON 写到 -o 指定的文件（默认标准输出），
+// 任何一项检查失败时退出码为 1。
+//
+// 用法: record_bench [-n 最小规模] [-N 最大规模] [-r 重复次数] [-o 输出文件]
+// 规模从 -n 开始每次乘 10 直到 -N。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../bubblesort.hpp"
+#include "distributions.hpp"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+struct Record {
+    int key;
+    std::unique_ptr<size_t> payload; // 原来的下标
+};
+
+int KeyOf(const Record& r) { return r.key; }
+
+std::vector<Record> MakeRecords(const std::vector<int>& keys) {
+    std::vector<Record> records(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        records[i].key = keys[i];
+        records[i].payload = std::make_unique<size_t>(i);
+    }
+    return records;
+}
+
+// records 是否与 std::stable_sort 得到的 (键, 原下标) 序列相同
+template <class Compare>
+bool MatchesStableSort(const std::vector<Record>& records, const std::vector<int>& keys,
+                       Compare comp) {
+    std::vector<std::pair<int, size_t>> ref(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ref[i] = {keys[i], i};
+    }
+    std::stable_sort(ref.begin(), ref.end(),
+                     [&comp](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+                         return comp(a.first, b.first);
+                     });
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (!records[i].payload || records[i].key != ref[i].first ||
+            *records[i].payload != ref[i].second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 用调用者提供的 scratch 排序一次并检查结果，同时检查没有分配堆内存
+template <class Compare>
+bool CheckSort(const std::vector<int>& keys, Compare comp,
+               std::vector<sorting::KeyIndex<int>>& scratch) {
+    std::vector<Record> records = MakeRecords(keys);
+    size_t before = allocations.load();
+    bool done = sorting::stable_sort_records(records.begin(), records.end(), KeyOf, comp,
+                                             scratch.data(), scratch.size());
+    size_t allocated = allocations.load() - before;
+    if (allocated != 0) {
+        std::cerr << "  " << allocated << " heap allocations during the sort" << std::endl;
+    }
+    return done && allocated == 0 && MatchesStableSort(records, keys, comp);
+}
+
+// scratch 不够时必须拒绝，并且不能动记录
+bool CheckSmallScratch(const std::vector<int>& keys,
+                       std::vector<sorting::KeyIndex<int>>& scratch) {
+    std::vector<Record> records = MakeRecords(keys);
+    size_t size = sorting::record_sort_scratch_size(keys.size()) - 1;
+    if (sorting::stable_sort_records(records.begin(), records.end(), KeyOf, scratch.data(),
+                                     size)) {
+        return false;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (records[i].key != keys[i] || *records[i].payload != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// 统计堆分配次数，检查排序时是否分配了内存
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    // 200、2000 ... 2e6 依次覆盖 pdqsort、8 位和 11 位基数排序
+    size_t minSize = 200;
+    size_t maxSize = 2000000;
+    int repeat = 3;
+    std::string outPath;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:N:r:o:")) != -1) {
+        switch (opt) {
+        case 'n':
+            minSize = strtod(optarg, nullptr);
+            break;
+        case 'N':
+            maxSize = strtod(optarg, nullptr);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-n min] [-N max] [-r repeat] [-o file]\n";
+            return 2;
+        }
+    }
+    if (minSize == 0 || maxSize < minSize || repeat < 1) {
+        std::cerr << "invalid arguments\n";
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            perror(outPath.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    bool ok = true;
+    bool first = true;
+    out << "{\n  \"repeat\": " << repeat << ",\n  \"results\": [\n";
+    for (size_t n = minSize; n <= maxSize; n *= 10) {
+        std::vector<int> keys(n);
+        std::vector<sorting::KeyIndex<int>> scratch(sorting::record_sort_scratch_size(n));
+        for (const char* dist : kDistributions) {
+            Generate(dist, keys, n);
+
+            const char* failed = !CheckSort(keys, std::less<int>(), scratch)      ? "std::less"
+                                 : !CheckSort(keys, std::greater<int>(), scratch) ? "std::greater"
+                                 : !CheckSmallScratch(keys, scratch) ? "small scratch"
+                                                                     : nullptr;
+            if (failed != nullptr) {
+                ok = false;
+                std::cerr << failed << " failed on " << dist << " n=" << n << std::endl;
+            }
+
+            double ours = 0, theirs = 0;
+            for (int i = 0; i < repeat; ++i) {
+                std::vector<Record> records = MakeRecords(keys);
+                auto start = std::chrono::steady_clock::now();
+                sorting::stable_sort_records(records.begin(), records.end(), KeyOf,
+                                             scratch.data(), scratch.size());
+                auto mid = std::chrono::steady_clock::now();
+                records = MakeRecords(keys);
+                auto start2 = std::chrono::steady_clock::now();
+                std::stable_sort(records.begin(), records.end(),
+                                 [](const Record& a, const Record& b) { return a.key < b.key; });
+                auto end = std::chrono::steady_clock::now();
+                double s = std::chrono::duration<double>(mid - start).count();
+                double t = std::chrono::duration<double>(end - start2).count();
+                ours = i == 0 ? s : std::min(ours, s);
+                theirs = i == 0 ? t : std::min(theirs, t);
+            }
+            out << (first ? "" : ",\n") << "    {\"distribution\": \"" << dist
+                << "\", \"size\": " << n << ", \"seconds\": " << ours
+                << ", \"std_stable_sort_seconds\": " << theirs
+                << ", \"ns_per_record\": " << ours * 1e9 / n << "}";
+            out.flush();
+            first = false;
+        }
+    }
+    out << "\n  ]\n}" << std::endl;
+    return ok ? 0 : 1;
+}
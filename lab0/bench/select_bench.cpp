@@ -0,0 +1,212 @@
+// select.hpp 的正确性检查和基准测试：对每种输入分布和规模，
+// 把 sorting::nth_element、sorting::partial_sort、sorting::top_k（迭代器和输入流两种）
+// 的结果与 std::nth_element、std::partial_sort 比较，k 取 0、1、n / 100、n / 2、n - 1 和 n，
+// 并对 k = n / 2（nth_element）和 k = n / 100（partial_sort、top_k）计时，与 std 中的同名函数对比。
+// 结果以 JSON 写到 -o 指定的文件（默认标准输出），任何一项检查失败时退出码为 1。
+//
+// 用法: select_bench [-n 最小规模] [-N 最大规模] [-r 重复次数] [-o 输出文件]
+// 规模从 -n 开始每次乘 10 直到 -N。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../bubblesort.hpp"
+#include "distributions.hpp"
+
+namespace {
+
+// 输入流版本的 top_k 每次都要格式化整个输入，只在不超过这个规模时检查
+constexpr size_t kStreamCheckMax = 100000;
+
+struct Op {
+    const char* name;
+    // 对 arr 的前 k 个做选择，k 的含义见各项
+    std::function<void(std::vector<int>&, size_t)> ours;
+    std::function<void(std::vector<int>&, size_t)> std;
+};
+
+// 两个序列作为多重集合是否相同
+bool SameElements(std::vector<int> a, std::vector<int> b) {
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+// 检查 sorting::nth_element 的结果：第 k 个与 std::nth_element 相同，
+// 前面的都不大于它、后面的都不小于它，并且没有丢失或改写元素
+bool CheckNth(const std::vector<int>& input, size_t k) {
+    std::vector<int> arr = input, ref = input;
+    sorting::nth_element(arr.begin(), arr.begin() + k, arr.end());
+    std::nth_element(ref.begin(), ref.begin() + k, ref.end());
+    if (k == input.size()) {
+        return arr == input;
+    }
+    int v = arr[k];
+    return v == ref[k] &&
+           std::all_of(arr.begin(), arr.begin() + k, [v](int x) { return x <= v; }) &&
+           std::all_of(arr.begin() + k, arr.end(), [v](int x) { return x >= v; }) &&
+           SameElements(arr, input);
+}
+
+// 检查 sorting::partial_sort：前 k 个与 std::partial_sort 完全相同，其余元素不丢失
+bool CheckPartialSort(const std::vector<int>& input, size_t k) {
+    std::vector<int> arr = input, ref = input;
+    sorting::partial_sort(arr.begin(), arr.begin() + k, arr.end());
+    std::partial_sort(ref.begin(), ref.begin() + k, ref.end());
+    return std::equal(arr.begin(), arr.begin() + k, ref.begin()) &&
+           SameElements(arr, input);
+}
+
+// 检查 sorting::top_k：最小和最大的 k 个都与 std::partial_sort 的前 k 个相同，
+// 规模不大时也检查输入流版本
+bool CheckTopK(const std::vector<int>& input, size_t k) {
+    std::vector<int> ref = input;
+    std::partial_sort(ref.begin(), ref.begin() + k, ref.end());
+    ref.resize(k);
+    if (sorting::top_k(input.begin(), input.end(), k) != ref) {
+        return false;
+    }
+
+    std::vector<int> largest = input;
+    std::partial_sort(largest.begin(), largest.begin() + k, largest.end(), std::greater<int>());
+    largest.resize(k);
+    if (sorting::top_k(input.begin(), input.end(), k, std::greater<int>()) != largest) {
+        return false;
+    }
+
+    if (input.size() <= kStreamCheckMax) {
+        std::stringstream ss;
+        for (int v : input) {
+            ss << v << '\n';
+        }
+        if (sorting::top_k<int>(ss, k) != ref) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 计时一次 f(arr, k)，arr 每次从 input 复制，返回最短的秒数
+double Time(const std::function<void(std::vector<int>&, size_t)>& f,
+            const std::vector<int>& input, size_t k, int repeat) {
+    std::vector<int> arr;
+    double best = 0;
+    for (int i = 0; i < repeat; ++i) {
+        arr = input;
+        auto start = std::chrono::steady_clock::now();
+        f(arr, k);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || s < best) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t minSize = 1000;
+    size_t maxSize = 1000000;
+    int repeat = 3;
+    std::string outPath;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:N:r:o:")) != -1) {
+        switch (opt) {
+        case 'n':
+            minSize = strtod(optarg, nullptr);
+            break;
+        case 'N':
+            maxSize = strtod(optarg, nullptr);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-n min] [-N max] [-r repeat] [-o file]\n";
+            return 2;
+        }
+    }
+    if (minSize == 0 || maxSize < minSize || repeat < 1) {
+        std::cerr << "invalid arguments\n";
+        return 2;
+    }
+
+    // 计时的各项操作，第二个参数为 k
+    std::vector<Op> ops = {
+        {"nth_element",
+         [](std::vector<int>& a, size_t k) { sorting::nth_element(a.begin(), a.begin() + k, a.end()); },
+         [](std::vector<int>& a, size_t k) { std::nth_element(a.begin(), a.begin() + k, a.end()); }},
+        {"partial_sort",
+         [](std::vector<int>& a, size_t k) { sorting::partial_sort(a.begin(), a.begin() + k, a.end()); },
+         [](std::vector<int>& a, size_t k) { std::partial_sort(a.begin(), a.begin() + k, a.end()); }},
+        // std 中没有单遍的 top_k，与 std::partial_sort_copy 对比
+        {"top_k",
+         [](std::vector<int>& a, size_t k) { a = sorting::top_k(a.begin(), a.end(), k); },
+         [](std::vector<int>& a, size_t k) {
+             std::vector<int> out(k);
+             std::partial_sort_copy(a.begin(), a.end(), out.begin(), out.end());
+             a = std::move(out);
+         }},
+    };
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            perror(outPath.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    bool ok = true;
+    bool first = true;
+    out << "{\n  \"repeat\": " << repeat << ",\n  \"results\": [\n";
+    for (size_t n = minSize; n <= maxSize; n *= 10) {
+        std::vector<int> input(n);
+        for (const char* dist : kDistributions) {
+            Generate(dist, input, n);
+
+            for (size_t k : {size_t(0), size_t(1), n / 100, n / 2, n - 1, n}) {
+                const char* failed = !CheckNth(input, k)           ? "nth_element"
+                                     : !CheckPartialSort(input, k) ? "partial_sort"
+                                     : !CheckTopK(input, k)        ? "top_k"
+                                                                   : nullptr;
+                if (failed != nullptr) {
+                    ok = false;
+                    std::cerr << failed << " failed on " << dist << " n=" << n << " k=" << k
+                              << std::endl;
+                }
+            }
+
+            for (const Op& op : ops) {
+                size_t k = op.name == std::string("nth_element") ? n / 2 : n / 100;
+                double ours = Time(op.ours, input, k, repeat);
+                double theirs = Time(op.std, input, k, repeat);
+                out << (first ? "" : ",\n") << "    {\"op\": \"" << op.name
+                    << "\", \"distribution\": \"" << dist << "\", \"size\": " << n
+                    << ", \"k\": " << k << ", \"seconds\": " << ours
+                    << ", \"std_seconds\": " << theirs
+                    << ", \"ns_per_element\": " << ours * 1e9 / n << "}";
+                out.flush();
+                first = false;
+            }
+        }
+    }
+    out << "\n  ]\n}" << std::endl;
+    return ok ? 0 : 1;
+}
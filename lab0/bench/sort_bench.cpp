@@ -0,0 +1,201 @@
+// 排序内核的基准测试：对每种输入分布和规模，分别计时各个排序内核，
+// 给出每个元素的纳秒数、吞吐量以及硬件计数器（cache-misses、branch-misses），
+// 并检查结果与 std::sort 的结果相同。结果以 JSON 写到 -o 指定的文件（默认标准输出）。
+//
+//   分布: random sorted reverse sawtooth few_unique zipf
+//   内核: bubbleSort std::sort pdqsort sorting::sort radix_sort parallelSort
+//
+// 用法: sort_bench [-n 最小规模] [-N 最大规模] [-r 重复次数] [-o 输出文件]
+// 规模从 -n 开始每次乘 10 直到 -N。perf_event_open 不可用时（容器、perf_event_paranoid 等）
+// 计数器一项为 null。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../bubblesort.hpp"
+#include "distributions.hpp"
+
+namespace {
+
+// 一个硬件计数器，只统计本线程的用户态事件（parallelSort 中其他线程的事件不计入）。
+// 打开失败时 ok() 为 false
+class PerfCounter {
+public:
+    explicit PerfCounter(uint64_t config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~PerfCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool ok() const { return fd_ >= 0; }
+
+    void Start() {
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    uint64_t Stop() {
+        uint64_t value = 0;
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &value, sizeof(value)) != sizeof(value)) {
+                value = 0;
+            }
+        }
+        return value;
+    }
+
+private:
+    int fd_;
+};
+
+struct Kernel {
+    const char* name;
+    std::function<void(std::vector<int>&)> sort;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t minSize = 1000;
+    size_t maxSize = 10000000;
+    int repeat = 3;
+    std::string outPath;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:N:r:o:")) != -1) {
+        switch (opt) {
+        case 'n':
+            minSize = strtod(optarg, nullptr);
+            break;
+        case 'N':
+            maxSize = strtod(optarg, nullptr);
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-n min] [-N max] [-r repeat] [-o file]\n";
+            return 2;
+        }
+    }
+    if (minSize == 0 || maxSize < minSize || repeat < 1) {
+        std::cerr << "invalid arguments\n";
+        return 2;
+    }
+
+    std::vector<Kernel> kernels = {
+        {"bubbleSort", [](std::vector<int>& a) { bubbleSort(a); }},
+        {"std::sort", [](std::vector<int>& a) { std::sort(a.begin(), a.end()); }},
+        // 用 lambda 作比较器，sorting::sort 不会改用基数排序，测的是 pdqsort 本身
+        {"pdqsort",
+         [](std::vector<int>& a) {
+             sorting::pdqsort(a.begin(), a.end(), [](int x, int y) { return x < y; });
+         }},
+        // 通用入口：少于 1024 个元素时是 pdqsort，小区间用排序网络；更多时是基数排序
+        {"sorting::sort", [](std::vector<int>& a) { sorting::sort(a.begin(), a.end()); }},
+        {"radix_sort", [](std::vector<int>& a) { sorting::radix_sort(a.data(), a.data() + a.size()); }},
+        {"parallelSort", [](std::vector<int>& a) { parallelSort(a); }},
+    };
+
+    PerfCounter cacheMisses(PERF_COUNT_HW_CACHE_MISSES);
+    PerfCounter branchMisses(PERF_COUNT_HW_BRANCH_MISSES);
+    bool counters = cacheMisses.ok() && branchMisses.ok();
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            perror(outPath.c_str());
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    bool ok = true;
+    bool first = true;
+    out << "{\n  \"repeat\": " << repeat << ",\n  \"perf_counters\": "
+        << (counters ? "true" : "false") << ",\n  \"results\": [\n";
+    for (size_t n = minSize; n <= maxSize; n *= 10) {
+        std::vector<int> input(n), arr(n), expected(n);
+        for (const char* dist : kDistributions) {
+            Generate(dist, input, n);
+            // 只检查有序不够：丢掉或改写了元素的内核同样能得到有序的结果
+            expected = input;
+            std::sort(expected.begin(), expected.end());
+            for (const Kernel& k : kernels) {
+                double best = 0;
+                uint64_t cm = 0, bm = 0;
+                bool sorted = true;
+                for (int i = 0; i < repeat; ++i) {
+                    arr = input;
+                    cacheMisses.Start();
+                    branchMisses.Start();
+                    auto start = std::chrono::steady_clock::now();
+                    k.sort(arr);
+                    double s = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+                    uint64_t b = branchMisses.Stop();
+                    uint64_t c = cacheMisses.Stop();
+                    if (i == 0 || s < best) {
+                        best = s;
+                        cm = c;
+                        bm = b;
+                    }
+                    sorted = sorted && arr == expected;
+                }
+                ok = ok && sorted;
+                if (!sorted) {
+                    std::cerr << k.name << " failed on " << dist << " n=" << n << std::endl;
+                }
+
+                out << (first ? "" : ",\n") << "    {\"kernel\": \"" << k.name
+                    << "\", \"distribution\": \"" << dist << "\", \"size\": " << n
+                    << ", \"seconds\": " << best
+                    << ", \"ns_per_element\": " << best * 1e9 / n
+                    << ", \"melem_per_sec\": " << n / best / 1e6;
+                if (counters) {
+                    out << ", \"cache_misses\": " << cm << ", \"branch_misses\": " << bm;
+                } else {
+                    out << ", \"cache_misses\": null, \"branch_misses\": null";
+                }
+                out << ", \"sorted\": " << (sorted ? "true" : "false") << "}";
+                out.flush();
+                first = false;
+            }
+        }
+    }
+    out << "\n  ]\n}" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -1,13 +1,15 @@
 #include <iostream>
 #include <vector>
 
+#include "bubblesort.hpp"
+
+// 保留原来的接口，实际排序交给 sort.hpp 中的 pdqsort
 void bubbleSort(std::vector<int>& arr) {
-    int n = arr.size();
-    for (int i = 0; i < n - 1; ++i) {
-        for (int j = 0; j < n - i - 1; ++j) {
-            if (arr[j] > arr[j + 1]) {
-                std::swap(arr[j], arr[j + 1]);
-            }
-        }
-    }
-}
\ No newline at end of file
+    sorting::sort(arr.begin(), arr.end());
+}
+
+void parallelSort(std::vector<int>& arr, sorting::ThreadPool& pool,
+                  size_t cutoff) {
+    sorting::parallel_sort(pool, arr.begin(), arr.end(), std::less<int>(),
+                           cutoff);
+}
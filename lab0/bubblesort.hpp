@@ -1,4 +1,13 @@
 #include <iostream>
 #include <vector>
 
-void bubbleSort(std::vector<int>& arr);
\ No newline at end of file
+#include "parallel_sort.hpp"
+#include "record_sort.hpp"
+#include "select.hpp"
+
+void bubbleSort(std::vector<int>& arr);
+
+// 多线程排序，在可复用的线程池 pool 上运行。元素少于 cutoff 时退回单线程的 bubbleSort
+void parallelSort(std::vector<int>& arr,
+                  sorting::ThreadPool& pool = sorting::ThreadPool::Default(),
+                  size_t cutoff = sorting::kParallelSortCutoff);
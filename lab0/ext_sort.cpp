@@ -0,0 +1,404 @@
+// 外部排序：输入可以比内存大。
+// 1. 按内存预算把输入分块读入，每块用 sorting::radix_sort 排好后写成一个临时的有序段（run）
+//    读下一块、写上一段与排序当前块同时进行，共用两个块缓冲区
+// 2. 用败者树对所有段做 k 路归并；段数超过一次能归并的路数时先合并成较少的段
+//
+// 用法: ext_sort [-m 内存MiB] [-t] [-T 临时目录] 输入文件 输出文件
+// 默认输入输出是本机字节序的 32 位整数；-t 时是以空白分隔的十进制整数，输出每行一个。
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loser_tree.hpp"
+#include "sort.hpp"
+
+namespace {
+
+// 归并时每一路至少有这么大的读缓冲区，决定一次最多归并多少路
+constexpr size_t kMinMergeBuffer = 256 << 10;
+
+[[noreturn]] void Die(const std::string& what) {
+    std::cerr << "ext_sort: " << what << ": " << strerror(errno) << std::endl;
+    exit(1);
+}
+
+// 读满 len 字节，除非遇到文件结束。返回读到的字节数
+size_t ReadFull(int fd, char* buf, size_t len, off_t* offset = nullptr) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = offset ? pread(fd, buf + done, len - done, *offset + done)
+                           : read(fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Die("read");
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    if (offset) {
+        *offset += done;
+    }
+    return done;
+}
+
+void WriteFull(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Die("write");
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+// 输入。二进制文件用大块 read 顺序读；文本文件整个 mmap 后顺序解析，
+// 已经解析过的部分及时 MADV_DONTNEED，内存占用不随文件大小增长
+class Input {
+public:
+    Input(const char* path, bool text) : text_(text) {
+        fd_ = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            Die(path);
+        }
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (!text_) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) < 0) {
+            Die(path);
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p == MAP_FAILED) {
+                Die(path);
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            map_ = static_cast<const char*>(p);
+        }
+    }
+
+    ~Input() {
+        if (map_) {
+            munmap(const_cast<char*>(map_), size_);
+        }
+        close(fd_);
+    }
+
+    // 读入最多 max 个整数，返回个数，0 表示输入结束
+    size_t Read(int* out, size_t max) {
+        if (!text_) {
+            size_t bytes = ReadFull(fd_, reinterpret_cast<char*>(out), max * sizeof(int));
+            if (bytes % sizeof(int) != 0) {
+                errno = EINVAL;
+                Die("input size is not a multiple of 4 bytes");
+            }
+            return bytes / sizeof(int);
+        }
+
+        size_t n = 0;
+        const char* end = map_ + size_;
+        while (n < max) {
+            while (pos_ < size_ && isspace(static_cast<unsigned char>(map_[pos_]))) {
+                ++pos_;
+            }
+            if (pos_ == size_) {
+                break;
+            }
+            std::from_chars_result r = std::from_chars(map_ + pos_, end, out[n]);
+            if (r.ec != std::errc()) {
+                errno = EINVAL;
+                Die("bad integer at byte " + std::to_string(pos_));
+            }
+            pos_ = r.ptr - map_;
+            ++n;
+        }
+        // 释放已经解析过的页
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t done = pos_ / page * page;
+        if (done > released_) {
+            madvise(const_cast<char*>(map_) + released_, done - released_, MADV_DONTNEED);
+            released_ = done;
+        }
+        return n;
+    }
+
+private:
+    int fd_;
+    bool text_;
+    const char* map_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = 0;
+    size_t released_ = 0;
+};
+
+// 带缓冲的输出，二进制或每行一个整数
+class Output {
+public:
+    Output(int fd, bool text, size_t bufSize) : fd_(fd), text_(text) {
+        buf_.reserve(bufSize);
+    }
+
+    ~Output() { Flush(); }
+
+    void Write(const int* data, size_t n) {
+        if (!text_) {
+            size_t bytes = n * sizeof(int);
+            if (bytes >= buf_.capacity()) {
+                // 大块数据（整个排好的块）直接写出
+                Flush();
+                WriteFull(fd_, reinterpret_cast<const char*>(data), bytes);
+                return;
+            }
+            if (buf_.size() + bytes > buf_.capacity()) {
+                Flush();
+            }
+            const char* p = reinterpret_cast<const char*>(data);
+            buf_.insert(buf_.end(), p, p + bytes);
+            return;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (buf_.size() + 16 > buf_.capacity()) {
+                Flush();
+            }
+            char num[16];
+            char* e = std::to_chars(num, num + sizeof(num), data[i]).ptr;
+            *e++ = '\n';
+            buf_.insert(buf_.end(), num, e);
+        }
+    }
+
+    void Put(int v) {
+        if (!text_ && buf_.size() + sizeof(int) <= buf_.capacity()) {
+            const char* p = reinterpret_cast<const char*>(&v);
+            buf_.insert(buf_.end(), p, p + sizeof(int));
+            return;
+        }
+        Write(&v, 1);
+    }
+
+    void Flush() {
+        WriteFull(fd_, buf_.data(), buf_.size());
+        buf_.clear();
+    }
+
+private:
+    int fd_;
+    bool text_;
+    std::vector<char> buf_;
+};
+
+// 临时文件中的一个有序段，总是二进制格式。文件创建后立即 unlink，进程退出时自动删除
+struct Run {
+    int fd;
+    size_t count;
+};
+
+int TempFile(const std::string& dir) {
+    std::string path = dir + "/ext_sort.XXXXXX";
+    int fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd < 0) {
+        Die(path);
+    }
+    unlink(path.c_str());
+    return fd;
+}
+
+void WriteRun(const Run& run, const int* data) {
+    WriteFull(run.fd, reinterpret_cast<const char*>(data), run.count * sizeof(int));
+}
+
+// 顺序读取一个段
+class RunReader {
+public:
+    RunReader(const Run& run, size_t bufInts) : run_(run), buf_(bufInts) {
+        posix_fadvise(run.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    bool Next(int& v) {
+        if (pos_ == len_) {
+            size_t want = std::min(buf_.size(), run_.count - consumed_);
+            if (want == 0) {
+                return false;
+            }
+            size_t bytes = ReadFull(run_.fd, reinterpret_cast<char*>(buf_.data()),
+                                    want * sizeof(int), &offset_);
+            if (bytes != want * sizeof(int)) {
+                errno = EIO;
+                Die("short read from run file");
+            }
+            consumed_ += want;
+            len_ = want;
+            pos_ = 0;
+        }
+        v = buf_[pos_++];
+        return true;
+    }
+
+private:
+    Run run_;
+    std::vector<int> buf_;
+    off_t offset_ = 0;
+    size_t consumed_ = 0;
+    size_t pos_ = 0;
+    size_t len_ = 0;
+};
+
+// 把 runs 归并写到 out，结束后关闭这些段
+void Merge(const std::vector<Run>& runs, Output& out, size_t budget) {
+    size_t bufInts = std::max(kMinMergeBuffer, budget / (runs.size() + 1)) / sizeof(int);
+    std::vector<RunReader> readers;
+    readers.reserve(runs.size());
+    sorting::LoserTree<int> tree(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+        readers.emplace_back(runs[i], bufInts);
+        int v;
+        if (readers[i].Next(v)) {
+            tree.Set(i, v);
+        }
+    }
+    tree.Build();
+    while (!tree.Empty()) {
+        out.Put(tree.TopKey());
+        int v;
+        if (readers[tree.Top()].Next(v)) {
+            tree.Replace(v);
+        } else {
+            tree.Pop();
+        }
+    }
+    out.Flush();
+    for (const Run& run : runs) {
+        close(run.fd);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t budgetMiB = 256;
+    bool text = false;
+    std::string tmpdir;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:tT:")) != -1) {
+        switch (opt) {
+        case 'm':
+            budgetMiB = strtoul(optarg, nullptr, 10);
+            break;
+        case 't':
+            text = true;
+            break;
+        case 'T':
+            tmpdir = optarg;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0]
+                      << " [-m budget_mib] [-t] [-T tmpdir] input output\n";
+            return 2;
+        }
+    }
+    if (argc - optind != 2 || budgetMiB == 0) {
+        std::cerr << "usage: " << argv[0]
+                  << " [-m budget_mib] [-t] [-T tmpdir] input output\n";
+        return 2;
+    }
+    const char* inPath = argv[optind];
+    const char* outPath = argv[optind + 1];
+    if (tmpdir.empty()) {
+        const char* env = getenv("TMPDIR");
+        tmpdir = env ? env : "/tmp";
+    }
+
+    // 分段阶段同时存在两个块缓冲区和基数排序的辅助空间，各占预算的三分之一
+    size_t budget = budgetMiB << 20;
+    size_t chunk = std::max<size_t>(budget / 3 / sizeof(int), 1024);
+
+    Input in(inPath, text);
+    int outFd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (outFd < 0) {
+        Die(outPath);
+    }
+
+    std::vector<int> buf[2] = {std::vector<int>(chunk), std::vector<int>(chunk)};
+    std::vector<int> scratch(chunk);
+    int cur = 0;
+    size_t n = in.Read(buf[cur].data(), chunk);
+
+    // 整个输入一块就能装下时直接排序输出
+    if (n < chunk) {
+        sorting::radix_sort(buf[cur].data(), buf[cur].data() + n, scratch.data());
+        Output out(outFd, text, 1 << 20);
+        out.Write(buf[cur].data(), n);
+        out.Flush();
+        close(outFd);
+        return 0;
+    }
+
+    // 排序当前块的同时，后台线程先把上一块写成段，再把下一块读进同一个缓冲区
+    std::vector<Run> runs;
+    int sorted = -1; // 已排好、还没有写出的缓冲区
+    while (n > 0) {
+        int other = cur ^ 1;
+        std::future<size_t> io = std::async(std::launch::async, [&, other, sorted] {
+            if (sorted >= 0) {
+                WriteRun(runs.back(), buf[sorted].data());
+            }
+            return in.Read(buf[other].data(), chunk);
+        });
+        sorting::radix_sort(buf[cur].data(), buf[cur].data() + n, scratch.data());
+        size_t next = io.get();
+        runs.push_back(Run{TempFile(tmpdir), n});
+        sorted = cur;
+        cur = other;
+        n = next;
+    }
+    WriteRun(runs.back(), buf[sorted].data());
+    buf[0] = std::vector<int>();
+    buf[1] = std::vector<int>();
+    scratch = std::vector<int>();
+
+    // 每一路的读缓冲区不小于 kMinMergeBuffer，段太多时先合并前面的若干段
+    size_t fanIn = std::max<size_t>(2, budget / kMinMergeBuffer - 1);
+    while (runs.size() > fanIn) {
+        std::vector<Run> group(runs.begin(), runs.begin() + fanIn);
+        runs.erase(runs.begin(), runs.begin() + fanIn);
+        Run merged{TempFile(tmpdir), 0};
+        for (const Run& r : group) {
+            merged.count += r.count;
+        }
+        {
+            Output w(merged.fd, false, budget / (fanIn + 1));
+            Merge(group, w, budget);
+        }
+        runs.push_back(merged);
+    }
+
+    Output out(outFd, text, budget / (runs.size() + 1));
+    Merge(runs, out, budget);
+    close(outFd);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef LOSER_TREE_HPP
+#define LOSER_TREE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace sorting {
+
+// k 路归并用的败者树。每个内部结点记录在该处比赛中落败的路，tree_[0] 是总的胜者。
+// 胜者那一路取出下一个元素后只需沿一条路径向上重赛 log2(k) 次，
+// 每层只与记录的败者比较一次，比二叉堆的 sift-down（每层两次比较）少一半。
+// 键相同时下标小的路获胜，所以归并是稳定的。
+template <class T, class Compare = std::less<T>>
+class LoserTree {
+public:
+    explicit LoserTree(std::size_t k, Compare comp = Compare())
+        : k_(k), keys_(k), done_(k, true), tree_(k == 0 ? 1 : k), comp_(comp) {}
+
+    // 设置第 i 路的第一个元素，在 Build 之前调用。没有设置的路视为已空
+    void Set(std::size_t i, T key) {
+        keys_[i] = std::move(key);
+        done_[i] = false;
+    }
+
+    void Build() {
+        if (k_ == 0) {
+            return;
+        }
+        // 叶子 i 位于 k + i，结点 n 的子结点是 2n 和 2n + 1
+        std::vector<std::size_t> winner(2 * k_);
+        for (std::size_t i = 0; i < k_; ++i) {
+            winner[k_ + i] = i;
+        }
+        for (std::size_t n = k_ - 1; n > 0; --n) {
+            std::size_t l = winner[2 * n];
+            std::size_t r = winner[2 * n + 1];
+            if (Beats(l, r)) {
+                winner[n] = l;
+                tree_[n] = r;
+            } else {
+                winner[n] = r;
+                tree_[n] = l;
+            }
+        }
+        tree_[0] = k_ == 1 ? 0 : winner[1];
+    }
+
+    // 所有路都已取完
+    bool Empty() const { return k_ == 0 || done_[tree_[0]]; }
+
+    // 当前最小元素所在的路和它的值
+    std::size_t Top() const { return tree_[0]; }
+    const T &TopKey() const { return keys_[tree_[0]]; }
+
+    // 胜者那一路的下一个元素为 key
+    void Replace(T key) {
+        std::size_t i = tree_[0];
+        keys_[i] = std::move(key);
+        Replay(i);
+    }
+
+    // 胜者那一路已经取完
+    void Pop() {
+        std::size_t i = tree_[0];
+        done_[i] = true;
+        Replay(i);
+    }
+
+private:
+    // a 路是否胜过 b 路。已空的路总是落败
+    bool Beats(std::size_t a, std::size_t b) const {
+        if (done_[a] || done_[b]) {
+            return !done_[a] && (done_[b] || a < b);
+        }
+        if (comp_(keys_[a], keys_[b])) {
+            return true;
+        }
+        return !comp_(keys_[b], keys_[a]) && a < b;
+    }
+
+    void Replay(std::size_t i) {
+        std::size_t winner = i;
+        for (std::size_t n = (k_ + i) / 2; n > 0; n /= 2) {
+            if (Beats(tree_[n], winner)) {
+                std::swap(tree_[n], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+    std::size_t k_;
+    std::vector<T> keys_;
+    std::vector<bool> done_;
+    std::vector<std::size_t> tree_;
+    Compare comp_;
+};
+
+} // namespace sorting
+
+#endif // LOSER_TREE_HPP
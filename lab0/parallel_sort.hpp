@@ -0,0 +1,272 @@
+#ifndef PARALLEL_SORT_HPP
+#define PARALLEL_SORT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "sort.hpp"
+
+namespace sorting {
+
+// 固定大小的线程池，可以在多次排序之间复用，避免每次创建线程。
+// size() 包括调用 ParallelFor 的线程本身，因此只创建 size() - 1 个工作线程
+class ThreadPool {
+public:
+    // threads 为 0 时使用 std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned i = 1; i < threads; ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread &t : workers_) {
+            t.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    // 对 [0, n) 中的每个 i 调用 f(i)，全部完成后返回。
+    // 调用线程也参与执行，下标由各线程动态领取，所以任务大小不均时也能自然地负载均衡
+    template <class F>
+    void ParallelFor(std::size_t n, F f) {
+        if (n == 0) {
+            return;
+        }
+        std::size_t helpers = std::min<std::size_t>(n, size()) - 1;
+        if (helpers == 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                f(i);
+            }
+            return;
+        }
+
+        struct State {
+            std::atomic<std::size_t> next{0};
+            std::size_t running;
+            std::mutex mutex;
+            std::condition_variable done;
+        } state;
+        state.running = helpers;
+
+        auto loop = [&state, &f, n] {
+            for (std::size_t i; (i = state.next.fetch_add(1)) < n;) {
+                f(i);
+            }
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (std::size_t i = 0; i < helpers; ++i) {
+                tasks_.emplace_back([&state, loop] {
+                    loop();
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    if (--state.running == 0) {
+                        state.done.notify_one();
+                    }
+                });
+            }
+        }
+        cv_.notify_all();
+
+        loop();
+        // state 在栈上，必须等所有工作线程都离开 loop 才能返回
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.done.wait(lock, [&state] { return state.running == 0; });
+    }
+
+    // 进程内共享的线程池，大小为 CPU 数
+    static ThreadPool &Default() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+// 元素少于这个数时并行的开销大于收益，直接单线程排序
+constexpr std::size_t kParallelSortCutoff = 1 << 16;
+
+namespace detail {
+
+// 把若干个有序区间归并到未初始化的 out 中（移动构造）。区间数就是线程数，用一个小根堆选最小的头部
+template <class Iter, class T, class Compare>
+void MultiwayMergeInto(std::vector<std::pair<Iter, Iter>> &runs, T *out,
+                       Compare comp) {
+    runs.erase(std::remove_if(runs.begin(), runs.end(),
+                              [](const std::pair<Iter, Iter> &r) {
+                                  return r.first == r.second;
+                              }),
+               runs.end());
+    // 堆顶是头部最小的区间
+    auto greater = [&comp](const std::pair<Iter, Iter> &a,
+                           const std::pair<Iter, Iter> &b) {
+        return comp(*b.first, *a.first);
+    };
+    std::make_heap(runs.begin(), runs.end(), greater);
+    while (runs.size() > 1) {
+        std::pop_heap(runs.begin(), runs.end(), greater);
+        std::pair<Iter, Iter> &r = runs.back();
+        ::new (static_cast<void *>(out++)) T(std::move(*r.first));
+        if (++r.first == r.second) {
+            runs.pop_back();
+        } else {
+            std::push_heap(runs.begin(), runs.end(), greater);
+        }
+    }
+    if (!runs.empty()) {
+        std::uninitialized_move(runs[0].first, runs[0].second, out);
+    }
+}
+
+} // namespace detail
+
+// 在 pool 上并行排序 [begin, end)，不稳定。
+// 采用按规则采样的并行排序（PSRS）：
+// 1. 分成 p 块，每个线程用 sorting::sort 排一块
+// 2. 从每个有序块中等距取样，排序后选出 p - 1 个分割点
+// 3. 按分割点在每块中二分，得到 p x p 个子区间
+// 4. 第 j 个线程把各块的第 j 个子区间多路归并到辅助缓冲区的对应位置，再并行移回原处
+// 需要 n 个元素的额外空间。少于 cutoff 个元素或线程池只有一个线程时退回 sorting::sort
+template <class Iter, class Compare>
+void parallel_sort(ThreadPool &pool, Iter begin, Iter end, Compare comp,
+                   std::size_t cutoff = kParallelSortCutoff) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    std::size_t n = end - begin;
+    // 每块至少 cutoff / 4 个元素，元素不多时不必用满所有线程
+    std::size_t p = std::min<std::size_t>(
+        pool.size(), n / std::max<std::size_t>(cutoff / 4, 1));
+    if (n < cutoff || p < 2) {
+        sorting::sort(begin, end, comp);
+        return;
+    }
+
+    // 1. 各块局部排序
+    std::vector<Iter> blocks(p + 1);
+    for (std::size_t i = 0; i <= p; ++i) {
+        blocks[i] = begin + n * i / p;
+    }
+    pool.ParallelFor(p, [&](std::size_t i) {
+        sorting::sort(blocks[i], blocks[i + 1], comp);
+    });
+
+    // 2. 每块取 samples 个等距样本。取样比 p - 1 多几倍，桶的大小更均匀
+    std::size_t samples = 8 * p;
+    std::vector<T> sample;
+    sample.reserve(p * samples);
+    for (std::size_t i = 0; i < p; ++i) {
+        std::size_t len = blocks[i + 1] - blocks[i];
+        for (std::size_t s = 1; s <= samples; ++s) {
+            sample.push_back(*(blocks[i] + (len * s / (samples + 1))));
+        }
+    }
+    sorting::sort(sample.begin(), sample.end(), comp);
+    std::vector<T> splitters;
+    for (std::size_t j = 1; j < p; ++j) {
+        splitters.push_back(sample[sample.size() * j / p]);
+    }
+
+    // 3. cut[i][j] 为第 i 块中第 j 个桶的起点，第 j 个桶是 (splitters[j-1], splitters[j]]。
+    // 重复元素很多时会有连续 m 个相同的分割点，这个值的所有元素本来都落在同一个桶里，
+    // 归并阶段就退化成单线程。此时把每块中等于它的区间按位置平分给相邻的 m + 1 个桶，
+    // 相等的元素放在哪个桶里都不影响结果
+    std::vector<std::vector<Iter>> cut(p, std::vector<Iter>(p + 1));
+    pool.ParallelFor(p, [&](std::size_t i) {
+        cut[i][0] = blocks[i];
+        for (std::size_t j = 1; j < p;) {
+            const T &v = splitters[j - 1];
+            std::size_t m = 1;
+            while (j + m < p && !comp(v, splitters[j + m - 1])) {
+                ++m;
+            }
+            if (m == 1) {
+                cut[i][j] = std::upper_bound(cut[i][j - 1], blocks[i + 1], v, comp);
+                ++j;
+                continue;
+            }
+            Iter lo = std::lower_bound(cut[i][j - 1], blocks[i + 1], v, comp);
+            Iter hi = std::upper_bound(lo, blocks[i + 1], v, comp);
+            for (std::size_t k = 0; k < m; ++k) {
+                cut[i][j + k] = lo + (hi - lo) * (k + 1) / (m + 1);
+            }
+            j += m;
+        }
+        cut[i][p] = blocks[i + 1];
+    });
+    std::vector<std::size_t> offset(p + 1, 0);
+    for (std::size_t j = 0; j < p; ++j) {
+        offset[j + 1] = offset[j];
+        for (std::size_t i = 0; i < p; ++i) {
+            offset[j + 1] += cut[i][j + 1] - cut[i][j];
+        }
+    }
+
+    // 4. 并行多路归并到辅助缓冲区，再移回
+    std::allocator<T> alloc;
+    T *buf = alloc.allocate(n);
+    pool.ParallelFor(p, [&](std::size_t j) {
+        std::vector<std::pair<Iter, Iter>> runs;
+        for (std::size_t i = 0; i < p; ++i) {
+            runs.emplace_back(cut[i][j], cut[i][j + 1]);
+        }
+        detail::MultiwayMergeInto(runs, buf + offset[j], comp);
+    });
+    pool.ParallelFor(p, [&](std::size_t j) {
+        std::move(buf + offset[j], buf + offset[j + 1], begin + offset[j]);
+        std::destroy(buf + offset[j], buf + offset[j + 1]);
+    });
+    alloc.deallocate(buf, n);
+}
+
+template <class Iter>
+void parallel_sort(ThreadPool &pool, Iter begin, Iter end) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    sorting::parallel_sort(pool, begin, end, std::less<T>());
+}
+
+} // namespace sorting
+
+#endif // PARALLEL_SORT_HPP
@@ -0,0 +1,254 @@
+#ifndef RADIX_SORT_HPP
+#define RADIX_SORT_HPP
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 整数的 LSD 基数排序，升序，不依赖比较。
+// - 一次预扫描同时统计所有位的直方图，之后每一趟只需要一次分发
+// - 所有元素在某一位上都相同时跳过这一趟（例如值都很小时的高位）
+// - 有符号整数把最高位取反，使负数排在前面
+// - 不超过 16 个的 32 位整数用排序网络，x86 上运行时按 CPUID 选 AVX-512、AVX2 或标量实现，
+//   其他架构只有标量实现
+// 超过 16 个元素时需要与输入等长的辅助空间。
+
+namespace sorting {
+
+namespace detail {
+
+// 每一趟处理的位数。11 位时 32 位整数只需 3 趟（8 位要 4 趟），但直方图有 2048 项，
+// 清零和求前缀和的固定开销较大，元素多于这个数时才值得
+constexpr std::size_t kWideRadixMin = std::size_t(1) << 20;
+
+// 没有 SIMD 时的退路，以及非 32 位整数的短输入
+template <class T>
+inline void ScalarNetwork16(T *data, std::size_t n) {
+    for (std::size_t i = 1; i < n; ++i) {
+        T tmp = data[i];
+        std::size_t j = i;
+        for (; j > 0 && tmp < data[j - 1]; --j) {
+            data[j] = data[j - 1];
+        }
+        data[j] = tmp;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// 16 路双调排序网络。第 i 路与第 i ^ j 路比较，
+// (i & j) == 0 与 (i & k) == 0 相同时取较小值，否则取较大值
+// GCC 12 的 AVX-512 头文件用未初始化的寄存器作为无掩码版本的占位参数，会误报 -Wuninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+template <class T>
+__attribute__((target("avx512f"))) inline void Avx512Network16(T *data,
+                                                               std::size_t n) {
+    constexpr bool kSigned = std::is_signed<T>::value;
+    __mmask16 valid = static_cast<__mmask16>((1u << n) - 1);
+    // 不足 16 个时用最大值补齐，补上的值排在最后，不会被写回
+    __m512i v = _mm512_mask_loadu_epi32(
+        _mm512_set1_epi32(kSigned ? INT32_MAX : -1), valid, data);
+    const __m512i lane = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                          5, 4, 3, 2, 1, 0);
+    for (int k = 2; k <= 16; k *= 2) {
+        __mmask16 ascending = _mm512_testn_epi32_mask(lane, _mm512_set1_epi32(k));
+        for (int j = k / 2; j > 0; j /= 2) {
+            __m512i jv = _mm512_set1_epi32(j);
+            __m512i other =
+                _mm512_permutexvar_epi32(_mm512_xor_si512(lane, jv), v);
+            __m512i mn = kSigned ? _mm512_min_epi32(v, other)
+                                 : _mm512_min_epu32(v, other);
+            __m512i mx = kSigned ? _mm512_max_epi32(v, other)
+                                 : _mm512_max_epu32(v, other);
+            __mmask16 low = _mm512_testn_epi32_mask(lane, jv);
+            v = _mm512_mask_blend_epi32(
+                static_cast<__mmask16>(~(low ^ ascending)), mx, mn);
+        }
+    }
+    _mm512_mask_storeu_epi32(data, valid, v);
+}
+#pragma GCC diagnostic pop
+
+template <bool Signed>
+__attribute__((target("avx2"))) inline __m256i Avx2Min(__m256i a, __m256i b) {
+    return Signed ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b);
+}
+
+template <bool Signed>
+__attribute__((target("avx2"))) inline __m256i Avx2Max(__m256i a, __m256i b) {
+    return Signed ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b);
+}
+
+// 与 Avx512Network16 相同的网络，16 路分放在两个 256 位寄存器中，j == 8 的一步跨寄存器比较
+template <class T>
+__attribute__((target("avx2"))) inline void Avx2Network16(T *data,
+                                                           std::size_t n) {
+    constexpr bool kSigned = std::is_signed<T>::value;
+    alignas(32) T buf[16];
+    for (std::size_t i = 0; i < 16; ++i) {
+        buf[i] = i < n ? data[i] : (kSigned ? T(INT32_MAX) : T(UINT32_MAX));
+    }
+    __m256i v[2] = {_mm256_load_si256(reinterpret_cast<const __m256i *>(buf)),
+                    _mm256_load_si256(reinterpret_cast<const __m256i *>(buf + 8))};
+    const __m256i local = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i lane[2] = {local, _mm256_add_epi32(local, _mm256_set1_epi32(8))};
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int k = 2; k <= 16; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            if (j == 8) {
+                // 只在 k == 16 时出现，此时所有路都是升序
+                __m256i mn = Avx2Min<kSigned>(v[0], v[1]);
+                v[1] = Avx2Max<kSigned>(v[0], v[1]);
+                v[0] = mn;
+                continue;
+            }
+            __m256i jv = _mm256_set1_epi32(j);
+            __m256i kv = _mm256_set1_epi32(k);
+            __m256i idx = _mm256_xor_si256(local, jv);
+            for (int r = 0; r < 2; ++r) {
+                __m256i other = _mm256_permutevar8x32_epi32(v[r], idx);
+                __m256i low = _mm256_cmpeq_epi32(_mm256_and_si256(lane[r], jv), zero);
+                __m256i ascending =
+                    _mm256_cmpeq_epi32(_mm256_and_si256(lane[r], kv), zero);
+                __m256i take_min = _mm256_cmpeq_epi32(low, ascending);
+                v[r] = _mm256_blendv_epi8(Avx2Max<kSigned>(v[r], other),
+                                          Avx2Min<kSigned>(v[r], other),
+                                          take_min);
+            }
+        }
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(buf), v[0]);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(buf + 8), v[1]);
+    std::memcpy(data, buf, n * sizeof(T));
+}
+
+#endif // x86
+
+// 对不超过 16 个 32 位整数排序，第一次调用时按 CPU 支持的指令集选定实现
+template <class T>
+inline void Network16(T *data, std::size_t n) {
+    static_assert(sizeof(T) == 4, "sorting networks handle 32-bit keys");
+#if defined(__x86_64__) || defined(__i386__)
+    using Fn = void (*)(T *, std::size_t);
+    static const Fn fn = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return static_cast<Fn>(Avx512Network16<T>);
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return static_cast<Fn>(Avx2Network16<T>);
+        }
+        return static_cast<Fn>(ScalarNetwork16<T>);
+    }();
+    fn(data, n);
+#else
+    ScalarNetwork16(data, n);
+#endif
+}
+
+struct Identity {
+    template <class T>
+    T operator()(T v) const {
+        return v;
+    }
+};
+
+// 按 key_of(元素) 得到的整数键排序。LSD 基数排序是稳定的，键相同的元素保持原来的先后顺序。
+// 元素需要能用 memcpy 复制，直方图放在栈上，整个过程不分配堆内存
+template <int kBits, class T, class KeyOf = Identity>
+inline void LsdRadixSort(T *data, std::size_t n, T *buf, KeyOf key_of = KeyOf()) {
+    using K = decltype(key_of(*data));
+    using U = typename std::make_unsigned<K>::type;
+    constexpr int kKeyBits = sizeof(K) * CHAR_BIT;
+    constexpr int kPasses = (kKeyBits + kBits - 1) / kBits;
+    constexpr std::size_t kBuckets = std::size_t(1) << kBits;
+    constexpr U kMask = static_cast<U>(kBuckets - 1);
+    // 有符号整数按补码比较时，只需要把符号位取反就能按无符号比较
+    constexpr U kFlip =
+        std::is_signed<K>::value ? static_cast<U>(U(1) << (kKeyBits - 1)) : 0;
+    auto key = [&key_of](const T &v) { return static_cast<U>(key_of(v)) ^ kFlip; };
+
+    std::size_t count[kPasses][kBuckets] = {};
+    for (std::size_t i = 0; i < n; ++i) {
+        U k = key(data[i]);
+        for (int p = 0; p < kPasses; ++p) {
+            ++count[p][(k >> (p * kBits)) & kMask];
+        }
+    }
+
+    T *src = data;
+    T *dst = buf;
+    for (int p = 0; p < kPasses; ++p) {
+        int shift = p * kBits;
+        std::size_t *c = count[p];
+        if (c[(key(src[0]) >> shift) & kMask] == n) {
+            continue;
+        }
+        std::size_t sum = 0;
+        for (std::size_t d = 0; d < kBuckets; ++d) {
+            std::size_t cnt = c[d];
+            c[d] = sum;
+            sum += cnt;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[c[(key(src[i]) >> shift) & kMask]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != data) {
+        std::memcpy(static_cast<void *>(data), src, n * sizeof(T));
+    }
+}
+
+} // namespace detail
+
+// 用 buf 作为辅助空间（至少 last - first 个元素，不超过 16 个元素时不使用）对整数升序排序
+template <class T>
+void radix_sort(T *first, T *last, T *buf) {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "radix_sort needs integer keys");
+    std::size_t n = last - first;
+    if (n < 2) {
+        return;
+    }
+    if (n <= 16) {
+        if constexpr (sizeof(T) == 4) {
+            detail::Network16(first, n);
+        } else {
+            detail::ScalarNetwork16(first, n);
+        }
+        return;
+    }
+    if (sizeof(T) >= 4 && n >= detail::kWideRadixMin) {
+        detail::LsdRadixSort<11>(first, n, buf);
+    } else {
+        detail::LsdRadixSort<8>(first, n, buf);
+    }
+}
+
+template <class T>
+void radix_sort(T *first, T *last) {
+    std::size_t n = last - first;
+    if (n <= 16) {
+        // 排序网络不需要辅助空间
+        sorting::radix_sort(first, last, static_cast<T *>(nullptr));
+        return;
+    }
+    std::unique_ptr<T[]> buf(new T[n]);
+    sorting::radix_sort(first, last, buf.get());
+}
+
+} // namespace sorting
+
+#endif // RADIX_SORT_HPP
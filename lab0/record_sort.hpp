@@ -0,0 +1,138 @@
+#ifndef RECORD_SORT_HPP
+#define RECORD_SORT_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "radix_sort.hpp"
+#include "sort.hpp"
+
+// 按键对带大块负载的记录做稳定排序。
+// 排序时只移动紧凑的 (键, 下标) 对，记录本身最后按得到的排列沿环移动，每条记录只移动一次，
+// 不复制负载，因此可以用于只能移动的类型。
+// 所有临时数据都放在调用者提供的 scratch 中，一次排序不分配堆内存。
+
+namespace sorting {
+
+template <class K>
+struct KeyIndex {
+    K key;
+    std::uint32_t index;
+};
+
+// scratch 至少需要的 KeyIndex<K> 个数
+inline std::size_t record_sort_scratch_size(std::size_t n) { return 2 * n; }
+
+namespace detail {
+
+// 键是整数并按 std::less 排序时用基数排序，它本身就是稳定的
+template <class K, class Compare>
+constexpr bool RecordRadix() {
+    return std::is_integral<K>::value && !std::is_same<K, bool>::value &&
+           (std::is_same<Compare, std::less<K>>::value ||
+            std::is_same<Compare, std::less<>>::value);
+}
+
+// 把 first 按 perm 重排：新的第 i 个是原来的第 perm[i] 个。perm 会被改写
+template <class Iter, class K>
+void ApplyPermutation(Iter first, KeyIndex<K> *perm, std::size_t n) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (perm[i].index == i) {
+            continue;
+        }
+        // 沿着环 i <- perm[i] <- perm[perm[i]] ... 移动，回到 i 时放入最初取出的记录
+        T tmp(std::move(first[i]));
+        std::size_t j = i;
+        while (perm[j].index != i) {
+            std::size_t next = perm[j].index;
+            first[j] = std::move(first[next]);
+            perm[j].index = static_cast<std::uint32_t>(j);
+            j = next;
+        }
+        first[j] = std::move(tmp);
+        perm[j].index = static_cast<std::uint32_t>(j);
+    }
+}
+
+} // namespace detail
+
+// 按 key_of(记录) 对 [first, last) 做稳定排序，键相同的记录保持原来的先后顺序。
+// scratch 有 scratch_size 个元素，少于 record_sort_scratch_size(last - first) 时
+// 不做任何事并返回 false。记录数不能超过 2^32 - 1。
+// 记录只需要能移动构造和移动赋值
+template <class Iter, class KeyOf, class Compare,
+          class K = typename std::decay<decltype(std::declval<KeyOf &>()(
+              *std::declval<Iter &>()))>::type>
+bool stable_sort_records(Iter first, Iter last, KeyOf key_of, Compare comp,
+                         KeyIndex<K> *scratch, std::size_t scratch_size) {
+    std::size_t n = last - first;
+    assert(n <= UINT32_MAX);
+    if (scratch_size < record_sort_scratch_size(n)) {
+        return false;
+    }
+    if (n < 2) {
+        return true;
+    }
+
+    KeyIndex<K> *pairs = scratch;
+    for (std::size_t i = 0; i < n; ++i) {
+        pairs[i].key = key_of(first[i]);
+        pairs[i].index = static_cast<std::uint32_t>(i);
+    }
+
+    bool sorted = false;
+    if constexpr (detail::RecordRadix<K, Compare>()) {
+        // 对 (键, 下标) 对做 LSD 基数排序，后一半 scratch 作为分发的缓冲区
+        auto key = [](const KeyIndex<K> &p) { return p.key; };
+        if (sizeof(K) >= 4 && n >= detail::kWideRadixMin) {
+            detail::LsdRadixSort<11>(pairs, n, pairs + n, key);
+            sorted = true;
+        } else if (static_cast<std::ptrdiff_t>(n) >= detail::kRadixSortThreshold) {
+            detail::LsdRadixSort<8>(pairs, n, pairs + n, key);
+            sorted = true;
+        }
+    }
+    if (!sorted) {
+        // 键相同时比较下标，不稳定的 pdqsort 也能得到稳定的结果
+        sorting::pdqsort(pairs, pairs + n,
+                         [&comp](const KeyIndex<K> &a, const KeyIndex<K> &b) {
+                             if (comp(a.key, b.key)) {
+                                 return true;
+                             }
+                             return !comp(b.key, a.key) && a.index < b.index;
+                         });
+    }
+
+    detail::ApplyPermutation(first, pairs, n);
+    return true;
+}
+
+template <class Iter, class KeyOf,
+          class K = typename std::decay<decltype(std::declval<KeyOf &>()(
+              *std::declval<Iter &>()))>::type>
+bool stable_sort_records(Iter first, Iter last, KeyOf key_of,
+                         KeyIndex<K> *scratch, std::size_t scratch_size) {
+    return sorting::stable_sort_records(first, last, key_of, std::less<K>(),
+                                        scratch, scratch_size);
+}
+
+// 自己分配 scratch 的版本
+template <class Iter, class KeyOf,
+          class K = typename std::decay<decltype(std::declval<KeyOf &>()(
+              *std::declval<Iter &>()))>::type>
+void stable_sort_records(Iter first, Iter last, KeyOf key_of) {
+    std::vector<KeyIndex<K>> scratch(record_sort_scratch_size(last - first));
+    sorting::stable_sort_records(first, last, key_of, std::less<K>(),
+                                 scratch.data(), scratch.size());
+}
+
+} // namespace sorting
+
+#endif // RECORD_SORT_HPP
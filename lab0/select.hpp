@@ -0,0 +1,180 @@
+#ifndef SELECT_HPP
+#define SELECT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "sort.hpp"
+
+// 只需要前 k 个或第 k 个元素时不必完整排序：
+// - nth_element: Floyd–Rivest 选择，期望比较次数约 n + min(k, n - k)，平均 O(n)
+// - partial_sort: 先选出前 k 个，再只对这 k 个排序，O(n + k log k)
+// - top_k: 对只能遍历一次的输入（输入迭代器、文件流）维护大小为 k 的堆，O(n log k) 时间、O(k) 内存
+// 与 std 中的同名函数参数相同，调用时需要写上 sorting::，否则实参依赖查找会产生歧义。
+
+namespace sorting {
+
+namespace detail {
+
+// 区间小于这个长度时直接插入排序
+constexpr std::ptrdiff_t kSelectInsertionThreshold = 24;
+// 区间大于这个长度时先在样本上递归，缩小枢轴的范围
+constexpr std::ptrdiff_t kFloydRivestThreshold = 600;
+
+// Floyd–Rivest 选择。[left, right] 是闭区间，k 为目标下标，都相对于 first。
+// 每一轮先在 k 附近取一个大小约 n^(2/3) 的样本递归选出枢轴，枢轴以很高的概率紧挨着第 k 个元素，
+// 一次划分就能把区间缩小到很小。划分轮数超过 bad_allowed 时说明输入在针对枢轴，改用 pdqsort
+template <class Iter, class Compare>
+void FloydRivest(Iter first, std::ptrdiff_t left, std::ptrdiff_t right,
+                 std::ptrdiff_t k, Compare comp, int bad_allowed) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    while (right > left) {
+        if (right - left < kSelectInsertionThreshold) {
+            InsertionSort(first + left, first + right + 1, comp);
+            return;
+        }
+        if (bad_allowed-- == 0) {
+            sorting::pdqsort(first + left, first + right + 1, comp);
+            return;
+        }
+
+        if (right - left > kFloydRivestThreshold) {
+            double n = static_cast<double>(right - left + 1);
+            double i = static_cast<double>(k - left + 1);
+            double z = std::log(n);
+            double s = 0.5 * std::exp(2 * z / 3);
+            double sd = 0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+            std::ptrdiff_t new_left = std::max(
+                left, static_cast<std::ptrdiff_t>(k - i * s / n + sd));
+            std::ptrdiff_t new_right = std::min(
+                right, static_cast<std::ptrdiff_t>(k + (n - i) * s / n + sd));
+            FloydRivest(first, new_left, new_right, k, comp, bad_allowed);
+        }
+
+        // 以 first[k] 为枢轴划分 [left, right]，结束后枢轴位于 j。
+        // 开始时把枢轴和一个不小于它的元素放在两端作为哨兵，内层循环不必检查边界
+        T t = first[k];
+        std::ptrdiff_t i = left;
+        std::ptrdiff_t j = right;
+        std::iter_swap(first + left, first + k);
+        if (comp(t, first[right])) {
+            std::iter_swap(first + right, first + left);
+        }
+        while (i < j) {
+            std::iter_swap(first + i, first + j);
+            ++i;
+            --j;
+            while (comp(first[i], t)) {
+                ++i;
+            }
+            while (comp(t, first[j])) {
+                --j;
+            }
+        }
+        if (!comp(first[left], t) && !comp(t, first[left])) {
+            std::iter_swap(first + left, first + j);
+        } else {
+            ++j;
+            std::iter_swap(first + j, first + right);
+        }
+
+        if (j <= k) {
+            left = j + 1;
+        }
+        if (k <= j) {
+            right = j - 1;
+        }
+    }
+}
+
+} // namespace detail
+
+// 重排 [first, last)，使 *nth 等于完整排序后该位置的元素，
+// 它前面的元素都不大于它，后面的元素都不小于它
+template <class Iter, class Compare>
+void nth_element(Iter first, Iter nth, Iter last, Compare comp) {
+    std::ptrdiff_t n = last - first;
+    if (n < 2 || nth == last) {
+        return;
+    }
+    detail::FloydRivest(first, 0, n - 1, nth - first, comp,
+                        2 * detail::Log2(n) + 4);
+}
+
+template <class Iter>
+void nth_element(Iter first, Iter nth, Iter last) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    sorting::nth_element(first, nth, last, std::less<T>());
+}
+
+// 使 [first, middle) 为整个区间中最小的 middle - first 个元素并且有序，其余元素的顺序不确定
+template <class Iter, class Compare>
+void partial_sort(Iter first, Iter middle, Iter last, Compare comp) {
+    if (middle == first) {
+        return;
+    }
+    if (middle == last) {
+        sorting::sort(first, last, comp);
+        return;
+    }
+    // 第 k 个元素就位后，它前面的都不大于它，只需再排前 k - 1 个
+    sorting::nth_element(first, middle - 1, last, comp);
+    sorting::sort(first, middle - 1, comp);
+}
+
+template <class Iter>
+void partial_sort(Iter first, Iter middle, Iter last) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    sorting::partial_sort(first, middle, last, std::less<T>());
+}
+
+// 从只遍历一次的输入中取出最小的 k 个元素，按 comp 升序返回（取最大的 k 个时传 std::greater）。
+// 维护一个以 comp 为序的大根堆，堆顶是目前留下的元素中最大的一个，
+// 新元素比堆顶小才需要替换。k 远小于 n 且输入随机时，绝大多数元素只与堆顶比较一次
+template <class InputIt, class Compare>
+std::vector<typename std::iterator_traits<InputIt>::value_type>
+top_k(InputIt first, InputIt last, std::size_t k, Compare comp) {
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    std::vector<T> heap;
+    if (k == 0) {
+        return heap;
+    }
+    heap.reserve(k);
+    for (; first != last && heap.size() < k; ++first) {
+        heap.push_back(*first);
+    }
+    std::make_heap(heap.begin(), heap.end(), comp);
+    for (; first != last; ++first) {
+        if (comp(*first, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), comp);
+            heap.back() = *first;
+            std::push_heap(heap.begin(), heap.end(), comp);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), comp);
+    return heap;
+}
+
+template <class InputIt>
+std::vector<typename std::iterator_traits<InputIt>::value_type>
+top_k(InputIt first, InputIt last, std::size_t k) {
+    using T = typename std::iterator_traits<InputIt>::value_type;
+    return sorting::top_k(first, last, k, std::less<T>());
+}
+
+// 从输入流中读取以空白分隔的 T，取出最小的 k 个。流中的数据不会全部读入内存
+template <class T, class Compare = std::less<T>>
+std::vector<T> top_k(std::istream &in, std::size_t k, Compare comp = Compare()) {
+    return sorting::top_k(std::istream_iterator<T>(in),
+                          std::istream_iterator<T>(), k, comp);
+}
+
+} // namespace sorting
+
+#endif // SELECT_HPP
@@ -0,0 +1,563 @@
+/*
+    pdqsort.h - Pattern-defeating quicksort.
+
+    Copyright (c) 2021 Orson Peters
+
+    This software is provided 'as-is', without any express or implied warranty. In no event will the
+    authors be held liable for any damages arising from the use of this software.
+
+    Permission is granted to anyone to use this software for any purpose, including commercial
+    applications, and to alter it and redistribute it freely, subject to the following restrictions:
+
+    1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+       original software. If you use this software in a product, an acknowledgment in the product
+       documentation would be appreciated but is not required.
+
+    2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+       being the original software.
+
+    3. This notice may not be removed or altered from any source distribution.
+*/
+
+// 本文件是修改过的版本，不是原始的 pdqsort.h：pdqsort 部分（插入排序、枢轴选取、
+// PartitionRight/PartitionLeft、按块的无分支划分及 PdqsortLoop）移植自上面的 pdqsort，
+// 改动了命名、注释和分支/无分支版本的选择方式，并增加了整数排序转发到基数排序的 sort 入口。
+
+#ifndef SORT_HPP
+#define SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "radix_sort.hpp"
+
+// 只有头文件的通用排序：pattern-defeating quicksort（pdqsort）。
+// - 小区间用插入排序，32 位整数升序排序时用排序网络
+// - 枢轴取三数中值，大区间取 ninther（三组三数中值的中值）
+// - 划分极不平衡的次数超过 log2(n) 时退化为堆排序，最坏 O(n log n)
+// - 比较器是 std::less/std::greater 且元素是算术类型时使用按块的无分支划分
+// - 检测已有序的区间，升序、降序、锯齿等输入接近 O(n)
+// 不稳定。要求随机访问迭代器，comp 为严格弱序。
+
+namespace sorting {
+
+namespace detail {
+
+// 小于这个长度的区间用插入排序
+constexpr std::ptrdiff_t kInsertionSortThreshold = 24;
+// 大于这个长度的区间用 ninther 取枢轴
+constexpr std::ptrdiff_t kNintherThreshold = 128;
+// 部分插入排序最多移动这么多个元素，超过说明输入并非接近有序
+constexpr std::size_t kPartialInsertionSortLimit = 8;
+// 无分支划分每次处理的块大小，偏移量用 unsigned char 保存
+constexpr std::ptrdiff_t kBlockSize = 64;
+constexpr std::ptrdiff_t kCachelineSize = 64;
+
+template <class T>
+struct IsDefaultCompare : std::false_type {};
+template <class T>
+struct IsDefaultCompare<std::less<T>> : std::true_type {};
+template <class T>
+struct IsDefaultCompare<std::greater<T>> : std::true_type {};
+
+// 比较只是一条指令、不会因为分支预测失败而付出代价时才值得无分支划分
+template <class Iter, class Compare>
+constexpr bool UseBranchless() {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    return IsDefaultCompare<Compare>::value && std::is_arithmetic<T>::value;
+}
+
+// 32 位整数按 std::less 升序排序、且元素连续存放时，不超过 kNetworkSize 个元素的小区间
+// 用 radix_sort.hpp 中的排序网络代替插入排序
+constexpr std::ptrdiff_t kNetworkSize = 16;
+
+template <class Iter, class Compare>
+constexpr bool UseNetwork() {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    return std::is_integral<T>::value && sizeof(T) == 4 &&
+           (std::is_same<Compare, std::less<T>>::value ||
+            std::is_same<Compare, std::less<>>::value) &&
+           (std::is_same<Iter, T *>::value ||
+            std::is_same<Iter, typename std::vector<T>::iterator>::value);
+}
+
+template <class T>
+inline int Log2(T n) {
+    int log = 0;
+    while (n >>= 1) {
+        ++log;
+    }
+    return log;
+}
+
+template <class Iter, class Compare>
+inline void InsertionSort(Iter begin, Iter end, Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    if (begin == end) {
+        return;
+    }
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != begin && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// *(begin - 1) 不大于区间内任何元素时可以省去边界检查
+template <class Iter, class Compare>
+inline void UnguardedInsertionSort(Iter begin, Iter end, Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    if (begin == end) {
+        return;
+    }
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+        }
+    }
+}
+
+// 尝试用插入排序完成排序，移动的元素过多时放弃并返回 false
+template <class Iter, class Compare>
+inline bool PartialInsertionSort(Iter begin, Iter end, Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    if (begin == end) {
+        return true;
+    }
+    std::size_t moved = 0;
+    for (Iter cur = begin + 1; cur != end; ++cur) {
+        Iter sift = cur;
+        Iter sift_1 = cur - 1;
+        if (comp(*sift, *sift_1)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*sift_1);
+            } while (sift != begin && comp(tmp, *--sift_1));
+            *sift = std::move(tmp);
+            moved += cur - sift;
+        }
+        if (moved > kPartialInsertionSortLimit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Iter, class Compare>
+inline void Sort2(Iter a, Iter b, Compare comp) {
+    if (comp(*b, *a)) {
+        std::iter_swap(a, b);
+    }
+}
+
+// 排序三个元素，中值落在 b
+template <class Iter, class Compare>
+inline void Sort3(Iter a, Iter b, Iter c, Compare comp) {
+    Sort2(a, b, comp);
+    Sort2(b, c, comp);
+    Sort2(a, b, comp);
+}
+
+template <class Iter, class Compare>
+inline void HeapSort(Iter begin, Iter end, Compare comp) {
+    std::make_heap(begin, end, comp);
+    std::sort_heap(begin, end, comp);
+}
+
+template <class T>
+inline T *AlignCacheline(T *p) {
+    std::uintptr_t ip = reinterpret_cast<std::uintptr_t>(p);
+    ip = (ip + kCachelineSize - 1) & -std::uintptr_t(kCachelineSize);
+    return reinterpret_cast<T *>(ip);
+}
+
+// 交换 first + offsets_l[i] 与 last - offsets_r[i]。两边数量相同时只能逐对交换，
+// 否则用一次循环移位代替，每个元素只移动一次
+template <class Iter>
+inline void SwapOffsets(Iter first, Iter last, unsigned char *offsets_l,
+                        unsigned char *offsets_r, std::size_t num,
+                        bool use_swaps) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    if (use_swaps) {
+        for (std::size_t i = 0; i < num; ++i) {
+            std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+        }
+    } else if (num > 0) {
+        Iter l = first + offsets_l[0];
+        Iter r = last - offsets_r[0];
+        T tmp(std::move(*l));
+        *l = std::move(*r);
+        for (std::size_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(tmp);
+    }
+}
+
+// 以 *begin 为枢轴划分 [begin, end)，等于枢轴的元素放在右边。
+// 返回枢轴的最终位置，以及划分前是否已经有序（没有发生交换）。
+// 要求区间中存在不小于枢轴的元素（由三数中值保证）。
+// 先按块扫描，把需要交换的元素偏移记在小数组里，比较结果直接累加到下标上，没有条件分支。
+template <class Iter, class Compare>
+inline std::pair<Iter, bool> PartitionRightBranchless(Iter begin, Iter end,
+                                                      Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    T pivot(std::move(*begin));
+    Iter first = begin;
+    Iter last = end;
+
+    // 跳过两端已经在正确一侧的元素
+    while (comp(*++first, pivot)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {
+        }
+    } else {
+        while (!comp(*--last, pivot)) {
+        }
+    }
+
+    bool already_partitioned = first >= last;
+    if (!already_partitioned) {
+        std::iter_swap(first, last);
+        ++first;
+
+        unsigned char offsets_l_storage[kBlockSize + kCachelineSize];
+        unsigned char offsets_r_storage[kBlockSize + kCachelineSize];
+        unsigned char *offsets_l = AlignCacheline(offsets_l_storage);
+        unsigned char *offsets_r = AlignCacheline(offsets_r_storage);
+        Iter offsets_l_base = first;
+        Iter offsets_r_base = last;
+        std::size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while (first < last) {
+            // 剩余元素不足两个块时在两边之间分配
+            std::size_t num_unknown = last - first;
+            std::size_t left_split =
+                num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            std::size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+            if (left_split >= static_cast<std::size_t>(kBlockSize)) {
+                for (unsigned char i = 0; i < kBlockSize;) {
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = i++; num_l += !comp(*first, pivot); ++first;
+                }
+            } else {
+                for (std::size_t i = 0; i < left_split;) {
+                    offsets_l[num_l] = static_cast<unsigned char>(i++);
+                    num_l += !comp(*first, pivot);
+                    ++first;
+                }
+            }
+
+            if (right_split >= static_cast<std::size_t>(kBlockSize)) {
+                for (unsigned char i = 0; i < kBlockSize;) {
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = ++i; num_r += comp(*--last, pivot);
+                }
+            } else {
+                for (std::size_t i = 0; i < right_split;) {
+                    offsets_r[num_r] = static_cast<unsigned char>(++i);
+                    num_r += comp(*--last, pivot);
+                }
+            }
+
+            std::size_t num = std::min(num_l, num_r);
+            SwapOffsets(offsets_l_base, offsets_r_base, offsets_l + start_l,
+                        offsets_r + start_r, num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // 一侧的块已经用完，另一侧剩下的元素逐个换到分界处
+        if (num_l) {
+            offsets_l += start_l;
+            while (num_l--) {
+                std::iter_swap(offsets_l_base + offsets_l[num_l], --last);
+            }
+            first = last;
+        }
+        if (num_r) {
+            offsets_r += start_r;
+            while (num_r--) {
+                std::iter_swap(offsets_r_base - offsets_r[num_r], first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+
+    Iter pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// 与 PartitionRightBranchless 相同，但使用普通的 Hoare 划分，适合开销较大的比较器
+template <class Iter, class Compare>
+inline std::pair<Iter, bool> PartitionRight(Iter begin, Iter end,
+                                            Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    T pivot(std::move(*begin));
+    Iter first = begin;
+    Iter last = end;
+
+    while (comp(*++first, pivot)) {
+    }
+    if (first - 1 == begin) {
+        while (first < last && !comp(*--last, pivot)) {
+        }
+    } else {
+        while (!comp(*--last, pivot)) {
+        }
+    }
+
+    bool already_partitioned = first >= last;
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(*++first, pivot)) {
+        }
+        while (!comp(*--last, pivot)) {
+        }
+    }
+
+    Iter pivot_pos = first - 1;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// 把等于枢轴的元素放在左边，返回枢轴位置。
+// 用于枢轴等于左侧相邻区间的最大值时：这些元素都已在最终位置，不需要再递归，
+// 大量重复元素的输入因此是 O(n) 的
+template <class Iter, class Compare>
+inline Iter PartitionLeft(Iter begin, Iter end, Compare comp) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    T pivot(std::move(*begin));
+    Iter first = begin;
+    Iter last = end;
+
+    while (comp(pivot, *--last)) {
+    }
+    if (last + 1 == end) {
+        while (first < last && !comp(pivot, *++first)) {
+        }
+    } else {
+        while (!comp(pivot, *++first)) {
+        }
+    }
+
+    while (first < last) {
+        std::iter_swap(first, last);
+        while (comp(pivot, *--last)) {
+        }
+        while (!comp(pivot, *++first)) {
+        }
+    }
+
+    Iter pivot_pos = last;
+    *begin = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return pivot_pos;
+}
+
+// pdqsort 主循环。bad_allowed 为还允许出现的极不平衡划分次数，
+// leftmost 为 false 时 *(begin - 1) 是不大于区间内所有元素的哨兵
+template <class Iter, class Compare, bool Branchless>
+inline void PdqsortLoop(Iter begin, Iter end, Compare comp, int bad_allowed,
+                        bool leftmost = true) {
+    using diff_t = typename std::iterator_traits<Iter>::difference_type;
+
+    // 对较大的一侧循环、较小的一侧递归
+    while (true) {
+        diff_t size = end - begin;
+
+        // 能用排序网络时一直划分到不超过 kNetworkSize 个元素
+        if constexpr (UseNetwork<Iter, Compare>()) {
+            if (size <= kNetworkSize) {
+                // 划分后的一侧可能为空，此时 begin == end，不能解引用
+                if (size > 1) {
+                    Network16(&*begin, size);
+                }
+                return;
+            }
+        } else if (size < kInsertionSortThreshold) {
+            if (leftmost) {
+                InsertionSort(begin, end, comp);
+            } else {
+                UnguardedInsertionSort(begin, end, comp);
+            }
+            return;
+        }
+
+        // 选取枢轴并放到 begin
+        diff_t s2 = size / 2;
+        if (size > kNintherThreshold) {
+            Sort3(begin, begin + s2, end - 1, comp);
+            Sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            Sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            Sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            std::iter_swap(begin, begin + s2);
+        } else {
+            Sort3(begin + s2, begin, end - 1, comp);
+        }
+
+        // 枢轴与左侧哨兵相等：区间中有大量等于它的元素，把它们一次划分到左边后跳过
+        if (!leftmost && !comp(*(begin - 1), *begin)) {
+            begin = PartitionLeft(begin, end, comp) + 1;
+            continue;
+        }
+
+        std::pair<Iter, bool> part =
+            Branchless ? PartitionRightBranchless(begin, end, comp)
+                       : PartitionRight(begin, end, comp);
+        Iter pivot_pos = part.first;
+        bool already_partitioned = part.second;
+
+        diff_t l_size = pivot_pos - begin;
+        diff_t r_size = end - (pivot_pos + 1);
+        bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+        if (highly_unbalanced) {
+            // 不平衡次数过多，说明输入在针对枢轴选取，改用堆排序保证 O(n log n)
+            if (--bad_allowed == 0) {
+                HeapSort(begin, end, comp);
+                return;
+            }
+
+            // 打乱两侧的几个元素，破坏可能存在的模式
+            if (l_size >= kInsertionSortThreshold) {
+                std::iter_swap(begin, begin + l_size / 4);
+                std::iter_swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > kNintherThreshold) {
+                    std::iter_swap(begin + 1, begin + (l_size / 4 + 1));
+                    std::iter_swap(begin + 2, begin + (l_size / 4 + 2));
+                    std::iter_swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    std::iter_swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= kInsertionSortThreshold) {
+                std::iter_swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                std::iter_swap(end - 1, end - r_size / 4);
+                if (r_size > kNintherThreshold) {
+                    std::iter_swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    std::iter_swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    std::iter_swap(end - 2, end - (1 + r_size / 4));
+                    std::iter_swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        } else if (already_partitioned &&
+                   PartialInsertionSort(begin, pivot_pos, comp) &&
+                   PartialInsertionSort(pivot_pos + 1, end, comp)) {
+            // 划分时没有发生交换，两侧很可能已经有序
+            return;
+        }
+
+        PdqsortLoop<Iter, Compare, Branchless>(begin, pivot_pos, comp,
+                                               bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+} // namespace detail
+
+// 用 comp 对 [begin, end) 做不稳定排序
+template <class Iter, class Compare>
+inline void pdqsort(Iter begin, Iter end, Compare comp) {
+    if (end - begin < 2) {
+        return;
+    }
+    detail::PdqsortLoop<Iter, Compare,
+                        detail::UseBranchless<Iter, Compare>()>(
+        begin, end, comp, detail::Log2(end - begin));
+}
+
+template <class Iter>
+inline void pdqsort(Iter begin, Iter end) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    sorting::pdqsort(begin, end, std::less<T>());
+}
+
+namespace detail {
+
+// 至少这么多个元素时基数排序比 pdqsort 快
+constexpr std::ptrdiff_t kRadixSortThreshold = 1024;
+
+// 整数按 std::less 升序排序、且元素连续存放（指针或 std::vector 的迭代器）时可以用基数排序
+template <class Iter, class Compare>
+constexpr bool UseRadixSort() {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    return std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+           (std::is_same<Compare, std::less<T>>::value ||
+            std::is_same<Compare, std::less<>>::value) &&
+           (std::is_same<Iter, T *>::value ||
+            std::is_same<Iter, typename std::vector<T>::iterator>::value);
+}
+
+} // namespace detail
+
+// 通用排序入口。整数升序排序在编译期选择基数排序，其余情况用 pdqsort
+template <class Iter, class Compare>
+inline void sort(Iter begin, Iter end, Compare comp) {
+    if constexpr (detail::UseRadixSort<Iter, Compare>()) {
+        if (end - begin >= detail::kRadixSortThreshold) {
+            sorting::radix_sort(&*begin, &*begin + (end - begin));
+            return;
+        }
+    }
+    sorting::pdqsort(begin, end, comp);
+}
+
+template <class Iter>
+inline void sort(Iter begin, Iter end) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    sorting::sort(begin, end, std::less<T>());
+}
+
+} // namespace sorting
+
+#endif // SORT_HPP
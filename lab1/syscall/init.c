@@ -1,10 +1,299 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/reboot.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "sysbench.h"
 
 #define SYS_HELLO 548
 
-int main() {
+// 一个极简的 init：启动配置的服务（默认是一个 shell），回收所有孤儿进程，
+// 崩溃的服务按指数退避重启，收到 SIGTERM/SIGINT 时关闭所有服务。
+// 空闲时阻塞在 epoll_wait 中，不占用 CPU。
+//
+// 配置文件（PID 1 时默认为 /etc/init.conf）每行一个服务，# 开头为注释：
+//   respawn /bin/sh        退出后重启
+//   once /bin/mount -a     只运行一次
+// 命令按空白切分后直接 execv，不经过 shell。命令行参数中的每个非选项参数也作为一个 respawn 服务。
+//
+// 在宿主机上用 -r 以 subreaper（PR_SET_CHILD_SUBREAPER）方式测试，服务的孙进程成为孤儿后
+// 也会交给本进程回收；所有服务都结束且不再重启时退出。
+
+#define MAX_SERVICES 32
+#define MAX_ARGS 32
+#define DEFAULT_CONF "/etc/init.conf"
+#define DEFAULT_SHELL "/bin/sh"
+
+// 运行时间不足 STABLE_SECONDS 就退出视为崩溃，重启间隔从 1 秒起每次翻倍，最多 MAX_BACKOFF 秒
+#define STABLE_SECONDS 10
+#define MAX_BACKOFF 60
+// 关闭时先发 SIGTERM，等待这么久后对剩下的进程发 SIGKILL
+#define SHUTDOWN_GRACE_MS 5000
+
+struct service {
+    char *line;            // 配置中的原始命令，用于日志
+    char *argv[MAX_ARGS + 1];
+    int respawn;
+    pid_t pid;             // 正在运行时为进程号，否则为 0
+    int backoff;           // 下一次崩溃后的重启间隔（秒）
+    double started;        // 最近一次启动的时间
+    double restart_at;     // 等待重启时为计划的时间，否则为 0
+};
+
+static struct service services[MAX_SERVICES];
+static int nservices;
+static int is_pid1;
+static int shutting_down;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int add_service(const char *cmd, int respawn) {
+    if (nservices == MAX_SERVICES) {
+        fprintf(stderr, "init: too many services, ignoring '%s'\n", cmd);
+        return -1;
+    }
+    struct service *s = &services[nservices];
+    memset(s, 0, sizeof(*s));
+    s->line = strdup(cmd);
+    char *copy = strdup(cmd);
+    int argc = 0;
+    for (char *save, *tok = strtok_r(copy, " \t", &save); tok && argc < MAX_ARGS;
+         tok = strtok_r(NULL, " \t", &save)) {
+        s->argv[argc++] = tok;
+    }
+    if (argc == 0) {
+        free(copy);
+        free(s->line);
+        return -1;
+    }
+    s->argv[argc] = NULL;
+    s->respawn = respawn;
+    s->backoff = 1;
+    nservices++;
+    return 0;
+}
+
+static void load_config(const char *path, int required) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        if (required) {
+            perror(path);
+        }
+        return;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+        size_t len = strcspn(p, " \t");
+        int respawn;
+        if (len == 7 && strncmp(p, "respawn", 7) == 0) {
+            respawn = 1;
+        } else if (len == 4 && strncmp(p, "once", 4) == 0) {
+            respawn = 0;
+        } else {
+            fprintf(stderr, "init: %s: unknown action in '%s'\n", path, p);
+            continue;
+        }
+        add_service(p + len + strspn(p + len, " \t"), respawn);
+    }
+    fclose(f);
+}
+
+static void start_service(struct service *s, const sigset_t *orig_mask) {
+    s->restart_at = 0;
+    s->started = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // 子进程恢复原来的信号屏蔽字，并成为新会话的首进程
+        sigprocmask(SIG_SETMASK, orig_mask, NULL);
+        setsid();
+        execv(s->argv[0], s->argv);
+        fprintf(stderr, "init: exec %s: %s\n", s->argv[0], strerror(errno));
+        _exit(127);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "init: fork: %s\n", strerror(errno));
+        s->restart_at = now() + s->backoff;
+        return;
+    }
+    s->pid = pid;
+}
+
+// 回收所有已结束的子进程，包括交给 init 的孤儿进程
+static void reap(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < nservices; i++) {
+            struct service *s = &services[i];
+            if (s->pid != pid) {
+                continue;
+            }
+            s->pid = 0;
+            if (shutting_down || !s->respawn) {
+                break;
+            }
+            // 稳定运行过一段时间的服务立即重启，否则按退避间隔等待
+            double ran = now() - s->started;
+            double delay = 0;
+            if (ran < STABLE_SECONDS) {
+                delay = s->backoff;
+                s->backoff = s->backoff * 2 > MAX_BACKOFF ? MAX_BACKOFF : s->backoff * 2;
+            } else {
+                s->backoff = 1;
+            }
+            if (WIFEXITED(status)) {
+                fprintf(stderr, "init: '%s' exited with status %d, restarting in %.0fs\n",
+                        s->line, WEXITSTATUS(status), delay);
+            } else {
+                fprintf(stderr, "init: '%s' killed by signal %d, restarting in %.0fs\n",
+                        s->line, WTERMSIG(status), delay);
+            }
+            s->restart_at = now() + delay;
+            break;
+        }
+    }
+}
+
+// 还有需要等待的事情：正在运行的服务、计划中的重启或其他子进程
+static int has_children(void) {
+    for (int i = 0; i < nservices; i++) {
+        if (services[i].pid != 0 || services[i].restart_at != 0) {
+            return 1;
+        }
+    }
+    // 孤儿进程不在服务列表中，用 waitid 探测是否还有子进程
+    siginfo_t info;
+    info.si_pid = 0;
+    return waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == 0;
+}
+
+static void begin_shutdown(void) {
+    shutting_down = 1;
+    fprintf(stderr, "init: shutting down\n");
+    for (int i = 0; i < nservices; i++) {
+        services[i].restart_at = 0;
+        if (services[i].pid > 0) {
+            kill(-services[i].pid, SIGTERM);
+            kill(services[i].pid, SIGTERM);
+        }
+    }
+    if (is_pid1) {
+        // PID 1 对 -1 发信号时会发给除自己之外的所有进程
+        kill(-1, SIGTERM);
+    }
+}
+
+static void finish_shutdown(void) {
+    for (int i = 0; i < nservices; i++) {
+        if (services[i].pid > 0) {
+            kill(-services[i].pid, SIGKILL);
+            kill(services[i].pid, SIGKILL);
+        }
+    }
+    if (is_pid1) {
+        kill(-1, SIGKILL);
+    }
+    while (waitpid(-1, NULL, 0) > 0) {
+    }
+    if (is_pid1) {
+        sync();
+        reboot(RB_POWER_OFF);
+    }
+    exit(0);
+}
+
+// 计算 epoll_wait 的超时：最近一次计划重启或关闭期限之前醒来，没有则一直阻塞
+static int next_timeout(double shutdown_deadline) {
+    double t = shutting_down ? shutdown_deadline : 0;
+    for (int i = 0; i < nservices; i++) {
+        double at = services[i].restart_at;
+        if (at != 0 && (t == 0 || at < t)) {
+            t = at;
+        }
+    }
+    if (t == 0) {
+        return -1;
+    }
+    double ms = (t - now()) * 1000;
+    return ms <= 0 ? 0 : (int)ms + 1;
+}
+
+static int run_init(const sigset_t *orig_mask, int sfd) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = sfd};
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev) < 0) {
+        perror("init: epoll");
+        return 1;
+    }
+
+    for (int i = 0; i < nservices; i++) {
+        start_service(&services[i], orig_mask);
+    }
+
+    double shutdown_deadline = 0;
+    while (1) {
+        if (!is_pid1 && !has_children()) {
+            return 0;
+        }
+        if (shutting_down && !has_children()) {
+            finish_shutdown();
+        }
+
+        struct epoll_event events[1];
+        int n = epoll_wait(epfd, events, 1, next_timeout(shutdown_deadline));
+        if (n < 0 && errno != EINTR) {
+            perror("init: epoll_wait");
+            return 1;
+        }
+
+        if (n > 0) {
+            struct signalfd_siginfo si;
+            while (read(sfd, &si, sizeof(si)) == sizeof(si)) {
+                if (si.ssi_signo == SIGCHLD) {
+                    reap();
+                } else if (!shutting_down) {
+                    begin_shutdown();
+                    shutdown_deadline = now() + SHUTDOWN_GRACE_MS / 1000.0;
+                }
+            }
+        }
+
+        if (shutting_down && now() >= shutdown_deadline) {
+            finish_shutdown();
+        }
+        double t = now();
+        for (int i = 0; i < nservices; i++) {
+            struct service *s = &services[i];
+            if (!shutting_down && s->restart_at != 0 && s->restart_at <= t) {
+                start_service(s, orig_mask);
+            }
+        }
+    }
+}
+
+static void hello_test(void) {
     char buf[50];
     long result;
     size_t buf_len = sizeof(buf);
@@ -24,8 +313,109 @@ int main() {
     } else {
         printf("System call returned -1, buffer is too small\n");
     }
+    fflush(stdout);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-r] [-f conf] [-B] [-n samples] [-w warmup] [-b batch] [-c cpu]"
+            " [-s syscall_nr] [command ...]\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    is_pid1 = getpid() == 1;
+
+    // 系统调用开销测试的参数，-B 时运行测试
+    struct sysbench_opts opts;
+    sysbench_default_opts(&opts);
+    int bench = 0;
+    int subreaper = 0;
+    const char *conf = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "rf:Bn:w:b:c:s:")) != -1) {
+        switch (opt) {
+        case 'r':
+            subreaper = 1;
+            break;
+        case 'f':
+            conf = optarg;
+            break;
+        case 'B':
+            bench = 1;
+            break;
+        case 'n':
+            opts.samples = atoi(optarg);
+            break;
+        case 'w':
+            opts.warmup = atoi(optarg);
+            break;
+        case 'b':
+            opts.batch = atoi(optarg);
+            break;
+        case 'c':
+            opts.cpu = atoi(optarg);
+            break;
+        case 's':
+            opts.extra_nr = atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (is_pid1) {
+        // 尽力挂载常用的伪文件系统，失败（已挂载或内核不支持）也继续
+        mkdir("/proc", 0555);
+        mkdir("/sys", 0555);
+        mkdir("/dev", 0755);
+        mount("proc", "/proc", "proc", 0, NULL);
+        mount("sysfs", "/sys", "sysfs", 0, NULL);
+        mount("devtmpfs", "/dev", "devtmpfs", 0, NULL);
+    }
+
+    hello_test();
+    if (bench && sysbench_run(&opts, stdout) < 0) {
+        perror("sysbench");
+    }
+
+    // 不是 PID 1 也没有要求作为 subreaper 运行时，到此结束
+    if (!is_pid1 && !subreaper) {
+        return 0;
+    }
+    if (subreaper && prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+        perror("init: PR_SET_CHILD_SUBREAPER");
+        return 1;
+    }
 
-    while(1){
+    if (conf) {
+        load_config(conf, 1);
+    } else if (is_pid1) {
+        load_config(DEFAULT_CONF, 0);
+    }
+    for (int i = optind; i < argc; i++) {
+        add_service(argv[i], 1);
+    }
+    if (nservices == 0 && is_pid1 && access(DEFAULT_SHELL, X_OK) == 0) {
+        add_service(DEFAULT_SHELL, 1);
+    }
 
+    // 这些信号都通过 signalfd 读取。PID 1 收到 SIGINT 表示 Ctrl-Alt-Del
+    sigset_t mask, orig_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigprocmask(SIG_BLOCK, &mask, &orig_mask);
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sfd < 0) {
+        perror("init: signalfd");
+        return 1;
+    }
+    if (is_pid1) {
+        reboot(RB_DISABLE_CAD);
     }
-}
\ No newline at end of file
+
+    return run_init(&orig_mask, sfd);
+}
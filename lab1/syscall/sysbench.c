@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include "sysbench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SYSBENCH_TSC 1
+#endif
+
+#define SYS_HELLO 548
+
+struct ctx {
+    int zero_fd;   // /dev/zero
+    long extra_nr;
+};
+
+struct bench {
+    const char *name;
+    void (*fn)(struct ctx *c, int n); // 连续调用 n 次
+    int batched;                      // 每个样本是否连续调用 opts->batch 次
+};
+
+// 读时间戳。rdtscp 等前面的指令都执行完才读，后面的 lfence 防止之后的指令提前开始
+static inline uint64_t now(void) {
+#ifdef SYSBENCH_TSC
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void bench_empty(struct ctx *c, int n) {
+    (void)c;
+    for (int i = 0; i < n; i++) {
+        __asm__ __volatile__("" ::: "memory");
+    }
+}
+
+static void bench_hello(struct ctx *c, int n) {
+    (void)c;
+    char buf[50];
+    for (int i = 0; i < n; i++) {
+        syscall(SYS_HELLO, buf, sizeof(buf));
+    }
+}
+
+// glibc 的 getpid() 曾经缓存过结果，这里直接发起系统调用
+static void bench_getpid(struct ctx *c, int n) {
+    (void)c;
+    for (int i = 0; i < n; i++) {
+        syscall(SYS_getpid);
+    }
+}
+
+static void bench_read_zero(struct ctx *c, int n) {
+    char byte;
+    for (int i = 0; i < n; i++) {
+        if (read(c->zero_fd, &byte, 1) != 1) {
+            break;
+        }
+    }
+}
+
+// 经过 vDSO，不进入内核
+static void bench_clock_vdso(struct ctx *c, int n) {
+    (void)c;
+    struct timespec ts;
+    for (int i = 0; i < n; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+}
+
+// 同一个功能强制走系统调用，与 vDSO 对比
+static void bench_clock_syscall(struct ctx *c, int n) {
+    (void)c;
+    struct timespec ts;
+    for (int i = 0; i < n; i++) {
+        syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+    }
+}
+
+static void bench_extra(struct ctx *c, int n) {
+    for (int i = 0; i < n; i++) {
+        syscall(c->extra_nr);
+    }
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 每纳秒的时间戳计数，用 CLOCK_MONOTONIC 校准约 20ms
+static double ticks_per_ns(void) {
+#ifdef SYSBENCH_TSC
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t t0 = now();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &b);
+    } while ((b.tv_sec - a.tv_sec) * 1000000000L + (b.tv_nsec - a.tv_nsec) < 20000000L);
+    uint64_t t1 = now();
+    double ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    return (t1 - t0) / ns;
+#else
+    return 1.0;
+#endif
+}
+
+static int pin_cpu(int cpu) {
+    if (cpu < 0) {
+        cpu = sched_getcpu();
+        if (cpu < 0) {
+            return -1;
+        }
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        return -1;
+    }
+    return cpu;
+}
+
+void sysbench_default_opts(struct sysbench_opts *opts) {
+    opts->samples = 10000;
+    opts->warmup = 1000;
+    opts->batch = 16;
+    opts->cpu = -1;
+    opts->extra_nr = -1;
+}
+
+int sysbench_run(const struct sysbench_opts *opts, FILE *out) {
+    if (opts->samples <= 0 || opts->batch <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct ctx c;
+    c.extra_nr = opts->extra_nr;
+    c.zero_fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+
+    int cpu = pin_cpu(opts->cpu);
+    double tpn = ticks_per_ns();
+
+    // 自定义的系统调用只在打过补丁的内核中存在
+    char buf[50];
+    int have_hello = !(syscall(SYS_HELLO, buf, sizeof(buf)) < 0 && errno == ENOSYS);
+
+    struct bench benches[] = {
+        {"empty", bench_empty, 0},
+        {"hello", bench_hello, 0},
+        {"getpid", bench_getpid, 0},
+        {"read_dev_zero", bench_read_zero, 0},
+        {"clock_gettime_vdso", bench_clock_vdso, 0},
+        {"clock_gettime_syscall", bench_clock_syscall, 0},
+        {"hello", bench_hello, 1},
+        {"getpid", bench_getpid, 1},
+        {"read_dev_zero", bench_read_zero, 1},
+        {"clock_gettime_vdso", bench_clock_vdso, 1},
+        {"extra", bench_extra, 0},
+    };
+    char extra_name[32];
+    snprintf(extra_name, sizeof(extra_name), "syscall_%ld", opts->extra_nr);
+    benches[sizeof(benches) / sizeof(benches[0]) - 1].name = extra_name;
+
+    uint64_t *samples = malloc(sizeof(uint64_t) * opts->samples);
+    if (samples == NULL) {
+        if (c.zero_fd >= 0) {
+            close(c.zero_fd);
+        }
+        return -1;
+    }
+
+#ifdef SYSBENCH_TSC
+    fprintf(out, "sysbench: cpu %d, %d samples, warmup %d, tsc %.3f GHz\n", cpu,
+            opts->samples, opts->warmup, tpn);
+    const char *unit = "cycles";
+#else
+    fprintf(out, "sysbench: cpu %d, %d samples, warmup %d, no tsc\n", cpu,
+            opts->samples, opts->warmup);
+    const char *unit = "ns";
+#endif
+    fprintf(out, "%-24s %6s %10s %10s %10s %10s %12s\n", "test", "batch", "min",
+            "median", "p99", "mean", "median_ns");
+
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        struct bench *bench = &benches[b];
+        if (bench->fn == bench_extra && opts->extra_nr < 0) {
+            continue;
+        }
+        if ((bench->fn == bench_hello && !have_hello) ||
+            (bench->fn == bench_read_zero && c.zero_fd < 0)) {
+            fprintf(out, "%-24s not available\n", bench->name);
+            continue;
+        }
+        int batch = bench->batched ? opts->batch : 1;
+
+        bench->fn(&c, opts->warmup);
+        double sum = 0;
+        for (int i = 0; i < opts->samples; i++) {
+            uint64_t t0 = now();
+            bench->fn(&c, batch);
+            samples[i] = now() - t0;
+            sum += samples[i];
+        }
+        qsort(samples, opts->samples, sizeof(uint64_t), cmp_u64);
+
+        double min = (double)samples[0] / batch;
+        double median = (double)samples[opts->samples / 2] / batch;
+        double p99 = (double)samples[(size_t)opts->samples * 99 / 100] / batch;
+        double mean = sum / opts->samples / batch;
+        fprintf(out, "%-24s %6d %10.1f %10.1f %10.1f %10.1f %12.1f\n", bench->name,
+                batch, min, median, p99, mean, median / tpn);
+    }
+    fprintf(out, "(%s per call; batch > 1 amortizes the timer over consecutive calls)\n",
+            unit);
+    fflush(out);
+
+    free(samples);
+    if (c.zero_fd >= 0) {
+        close(c.zero_fd);
+    }
+    return 0;
+}
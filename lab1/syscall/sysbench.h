@@ -0,0 +1,23 @@
+#ifndef SYSBENCH_H
+#define SYSBENCH_H
+
+#include <stdio.h>
+
+// 系统调用开销测试。每个测试先预热，再取若干个样本，
+// 每个样本连续调用 batch 次，用 rdtsc 计时后除以 batch 得到单次调用的周期数。
+// 既可以在 initramfs 中作为 init 的一部分运行，也可以在宿主机上作为普通程序运行。
+
+struct sysbench_opts {
+    int samples;   // 每个测试的样本数
+    int warmup;    // 正式计时前的预热调用次数
+    int batch;     // 批量测试中每个样本连续调用的次数
+    int cpu;       // 绑定的 CPU，-1 表示绑定在当前所在的 CPU
+    long extra_nr; // 额外测试的系统调用号（无参数调用），-1 表示不测
+};
+
+void sysbench_default_opts(struct sysbench_opts *opts);
+
+// 运行所有测试并把结果写到 out，成功返回 0
+int sysbench_run(const struct sysbench_opts *opts, FILE *out);
+
+#endif // SYSBENCH_H
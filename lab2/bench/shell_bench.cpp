@@ -0,0 +1,300 @@
+// shell 吞吐基准：生成若干脚本，通过管道喂给被测 shell 的标准输入（-s 时作为脚本文件参数），
+// 测量每秒能执行多少条命令。
+//
+//   simple      外部命令 /bin/true
+//   redirect    > 和 < 重定向
+//   heredoc     带多行正文的 here-doc
+//   pipeline    N 段管道传输大量数据，同时给出 MiB/s
+//   background  大量后台 job，最后 wait
+//
+// 用法: shell_bench [-S shell] [-b baseline] [-n 命令数] [-p 管道段数] [-d 每条管道的MiB]
+//                   [-j 后台job数] [-r 重复次数] [-s]
+// -b /bin/sh 时在同样的脚本上再测一遍基准 shell 并给出加速比。结果以 JSON 输出到标准输出。
+
+// IO
+#include <iostream>
+// std::string
+#include <string>
+// std::vector
+#include <vector>
+// std::chrono
+#include <chrono>
+// strtoul
+#include <cstdlib>
+// strerror
+#include <cstring>
+// POSIX API
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct Workload {
+  std::string name;
+  std::string script;
+  size_t commands; // 脚本中的命令数
+  size_t bytes;    // 经过管道的数据量，不涉及时为 0
+};
+
+struct Result {
+  double seconds = 0; // 多次运行中最快的一次
+  double user = 0;    // 该次运行的 CPU 时间（shell 及其子进程）
+  double sys = 0;
+  int status = 0;
+};
+
+bool WriteAll(int fd, const std::string &data) {
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t n = write(fd, data.data() + done, data.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+double Seconds(const struct timeval &tv) {
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// 运行一次 shell。scriptFile 不为空时作为参数传给 shell，否则把 script 写入 shell 的标准输入。
+// shell 的标准输出和标准错误都指向 /dev/null
+Result RunOnce(const std::string &shell, const std::string &script,
+               const std::string &scriptFile, const std::string &dir) {
+  int pipefd[2] = {-1, -1};
+  if (scriptFile.empty() && pipe2(pipefd, O_CLOEXEC) < 0) {
+    perror("pipe");
+    exit(1);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_RDWR);
+    dup2(scriptFile.empty() ? pipefd[0] : null_fd, 0);
+    dup2(null_fd, 1);
+    dup2(null_fd, 2);
+    if (chdir(dir.c_str()) != 0) {
+      _exit(127);
+    }
+    if (scriptFile.empty()) {
+      execl(shell.c_str(), shell.c_str(), static_cast<char *>(nullptr));
+    } else {
+      execl(shell.c_str(), shell.c_str(), scriptFile.c_str(),
+            static_cast<char *>(nullptr));
+    }
+    _exit(127);
+  }
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+
+  if (scriptFile.empty()) {
+    close(pipefd[0]);
+    WriteAll(pipefd[1], script);
+    close(pipefd[1]);
+  }
+
+  Result r;
+  struct rusage usage;
+  wait4(pid, &r.status, 0, &usage);
+  r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  // wait4 得到的用量包括 shell 本身以及它回收过的所有子进程
+  r.user = Seconds(usage.ru_utime);
+  r.sys = Seconds(usage.ru_stime);
+  return r;
+}
+
+Result Run(const std::string &shell, const Workload &w, int repeat,
+           const std::string &dir, bool asFile) {
+  std::string file;
+  if (asFile) {
+    file = dir + "/" + w.name + ".sh";
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || !WriteAll(fd, w.script)) {
+      perror(file.c_str());
+      exit(1);
+    }
+    close(fd);
+  }
+
+  Result best;
+  for (int i = 0; i < repeat; i++) {
+    Result r = RunOnce(shell, w.script, file, dir);
+    if (i == 0 || r.seconds < best.seconds) {
+      best = r;
+    }
+  }
+  return best;
+}
+
+std::vector<Workload> MakeWorkloads(size_t n, int stages, size_t mib,
+                                    size_t bgJobs) {
+  std::vector<Workload> ws;
+
+  Workload simple{"simple", "", n, 0};
+  for (size_t i = 0; i < n; i++) {
+    simple.script += "/bin/true\n";
+  }
+  ws.push_back(simple);
+
+  Workload redirect{"redirect", "", (n + 1) / 2 * 2, 0};
+  for (size_t i = 0; i < n; i += 2) {
+    redirect.script += "/bin/echo hello > out.txt\n/bin/cat < out.txt >> log.txt\n";
+  }
+  ws.push_back(redirect);
+
+  Workload heredoc{"heredoc", "", n, 0};
+  for (size_t i = 0; i < n; i++) {
+    heredoc.script += "/bin/cat > /dev/null <<EOF\n";
+    for (int line = 0; line < 20; line++) {
+      heredoc.script += "the quick brown fox jumps over the lazy dog\n";
+    }
+    heredoc.script += "EOF\n";
+  }
+  ws.push_back(heredoc);
+
+  // 每条管道传输 mib MiB，中间有 stages-2 个 cat
+  size_t runs = 4;
+  Workload pipeline{"pipeline", "", runs, runs * (mib << 20)};
+  std::string line = "/usr/bin/head -c " + std::to_string(mib << 20) + " /dev/zero";
+  for (int i = 2; i < stages; i++) {
+    line += " | /bin/cat";
+  }
+  line += " | /usr/bin/wc -c\n";
+  for (size_t i = 0; i < runs; i++) {
+    pipeline.script += line;
+  }
+  ws.push_back(pipeline);
+
+  Workload background{"background", "", bgJobs + 1, 0};
+  for (size_t i = 0; i < bgJobs; i++) {
+    background.script += "/bin/true &\n";
+  }
+  background.script += "wait\n";
+  ws.push_back(background);
+
+  return ws;
+}
+
+void PrintResult(const Workload &w, const Result &r) {
+  std::cout << "{\"seconds\": " << r.seconds
+            << ", \"commands_per_sec\": " << w.commands / r.seconds
+            << ", \"cpu_user\": " << r.user << ", \"cpu_sys\": " << r.sys
+            << ", \"exit_status\": "
+            << (WIFEXITED(r.status) ? WEXITSTATUS(r.status) : -1);
+  if (w.bytes > 0) {
+    std::cout << ", \"mib_per_sec\": " << (w.bytes >> 20) / r.seconds;
+  }
+  std::cout << "}";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string shell = "./shell";
+  std::string baseline;
+  size_t n = 500;
+  int stages = 8;
+  size_t mib = 64;
+  size_t bgJobs = 200;
+  int repeat = 3;
+  bool asFile = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "S:b:n:p:d:j:r:s")) != -1) {
+    switch (opt) {
+    case 'S':
+      shell = optarg;
+      break;
+    case 'b':
+      baseline = optarg;
+      break;
+    case 'n':
+      n = strtoul(optarg, nullptr, 10);
+      break;
+    case 'p':
+      stages = atoi(optarg);
+      break;
+    case 'd':
+      mib = strtoul(optarg, nullptr, 10);
+      break;
+    case 'j':
+      bgJobs = strtoul(optarg, nullptr, 10);
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      break;
+    case 's':
+      asFile = true;
+      break;
+    default:
+      std::cerr << "usage: " << argv[0]
+                << " [-S shell] [-b baseline] [-n commands] [-p stages]"
+                   " [-d mib] [-j jobs] [-r repeat] [-s]\n";
+      return 2;
+    }
+  }
+  if (n == 0 || stages < 2 || repeat < 1) {
+    std::cerr << "invalid arguments\n";
+    return 2;
+  }
+
+  // shell 提前退出时写管道不应终止基准程序
+  signal(SIGPIPE, SIG_IGN);
+
+  // 相对路径的 shell 在切换到临时目录之前先解析为绝对路径
+  char resolved[4096];
+  if (shell.find('/') != std::string::npos &&
+      realpath(shell.c_str(), resolved) != nullptr) {
+    shell = resolved;
+  }
+
+  char tmpl[] = "/tmp/shell_bench.XXXXXX";
+  if (mkdtemp(tmpl) == nullptr) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string dir = tmpl;
+
+  std::vector<Workload> ws = MakeWorkloads(n, stages, mib, bgJobs);
+  std::cout << "{\n  \"shell\": \"" << shell << "\",\n  \"baseline\": \""
+            << baseline << "\",\n  \"input\": \""
+            << (asFile ? "script" : "stdin") << "\",\n  \"repeat\": "
+            << repeat << ",\n  \"results\": [\n";
+  for (size_t i = 0; i < ws.size(); i++) {
+    const Workload &w = ws[i];
+    Result r = Run(shell, w, repeat, dir, asFile);
+    std::cout << "    {\"workload\": \"" << w.name
+              << "\", \"commands\": " << w.commands << ", \"shell\": ";
+    PrintResult(w, r);
+    if (!baseline.empty()) {
+      Result b = Run(baseline, w, repeat, dir, asFile);
+      std::cout << ", \"baseline\": ";
+      PrintResult(w, b);
+      std::cout << ", \"speedup\": " << b.seconds / r.seconds;
+    }
+    std::cout << "}" << (i + 1 < ws.size() ? ",\n" : "\n");
+    std::cout.flush();
+  }
+  std::cout << "  ]\n}" << std::endl;
+
+  // 清理临时目录
+  for (const char *name : {"out.txt", "log.txt", "simple.sh", "redirect.sh",
+                           "heredoc.sh", "pipeline.sh", "background.sh"}) {
+    unlink((dir + "/" + name).c_str());
+  }
+  rmdir(dir.c_str());
+  return 0;
+}
@@ -0,0 +1,687 @@
+#include "builtins.hpp"
+
+// IO
+#include <iostream>
+// std::string
+#include <string>
+// isdigit
+#include <cctype>
+// errno
+#include <cerrno>
+// PATH_MAX 等常量
+#include <climits>
+// snprintf
+#include <cstdio>
+// strtoll, setenv
+#include <cstdlib>
+// strchr
+#include <cstring>
+// POSIX API
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Entry {
+  const char *name;
+  BuiltinFn fn;
+};
+
+const Entry builtins[] = {
+    {"echo", BuiltinEcho},   {"printf", BuiltinPrintf}, {"test", BuiltinTest},
+    {"[", BuiltinTest},      {"true", BuiltinTrue},     {":", BuiltinTrue},
+    {"false", BuiltinFalse}, {"read", BuiltinRead},     {"pwd", BuiltinPwd},
+    {"exit", BuiltinExit},   {"cd", BuiltinCd},         {"wait", BuiltinWait},
+    {"hash", BuiltinHash},   {"jobs", BuiltinJobs},     {"fg", BuiltinFg},
+    {"bg", BuiltinBg},       {"parallel", BuiltinParallel}, {"set", BuiltinSet},
+};
+
+bool IsOctal(char c) { return c >= '0' && c <= '7'; }
+
+// 解析 s[i] 处开始的反斜杠转义（s[i] == '\\'），结果追加到 out，返回最后一个被消耗字符的下标。
+// echo 的八进制转义写作 \0nnn，printf 写作 \nnn。遇到 \c 时把 stop 置为 true
+size_t AppendEscape(std::string &out, std::string_view s, size_t i,
+                    bool printfStyle, bool &stop) {
+  if (i + 1 >= s.size()) {
+    out += '\\';
+    return i;
+  }
+  char c = s[++i];
+  switch (c) {
+  case 'a':
+    out += '\a';
+    return i;
+  case 'b':
+    out += '\b';
+    return i;
+  case 'c':
+    stop = true;
+    return i;
+  case 'e':
+    out += '\033';
+    return i;
+  case 'f':
+    out += '\f';
+    return i;
+  case 'n':
+    out += '\n';
+    return i;
+  case 'r':
+    out += '\r';
+    return i;
+  case 't':
+    out += '\t';
+    return i;
+  case 'v':
+    out += '\v';
+    return i;
+  case '\\':
+    out += '\\';
+    return i;
+  case 'x': {
+    int value = 0, digits = 0;
+    while (digits < 2 && i + 1 < s.size() &&
+           isxdigit(static_cast<unsigned char>(s[i + 1]))) {
+      char h = s[++i];
+      value = value * 16 + (isdigit(static_cast<unsigned char>(h))
+                                ? h - '0'
+                                : (tolower(h) - 'a' + 10));
+      ++digits;
+    }
+    if (digits == 0) {
+      out += "\\x";
+    } else {
+      out += static_cast<char>(value);
+    }
+    return i;
+  }
+  default:
+    break;
+  }
+
+  if (IsOctal(c) && (printfStyle || c == '0')) {
+    // echo: \0 之后最多 3 位；printf: 包括第一位在内最多 3 位
+    int value = printfStyle ? c - '0' : 0;
+    int digits = printfStyle ? 1 : 0;
+    while (digits < 3 && i + 1 < s.size() && IsOctal(s[i + 1])) {
+      value = value * 8 + (s[++i] - '0');
+      ++digits;
+    }
+    out += static_cast<char>(value);
+    return i;
+  }
+
+  // 不认识的转义原样保留
+  out += '\\';
+  out += c;
+  return i;
+}
+
+// 展开 s 中的全部转义，遇到 \c 时返回 false
+bool AppendEscaped(std::string &out, std::string_view s, bool printfStyle) {
+  bool stop = false;
+  for (size_t i = 0; i < s.size() && !stop; i++) {
+    if (s[i] == '\\') {
+      i = AppendEscape(out, s, i, printfStyle, stop);
+    } else {
+      out += s[i];
+    }
+  }
+  return !stop;
+}
+
+template <typename T>
+void AppendFormat(std::string &out, const std::string &spec, T value) {
+  int n = snprintf(nullptr, 0, spec.c_str(), value);
+  if (n <= 0) {
+    return;
+  }
+  size_t old = out.size();
+  out.resize(old + n + 1);
+  snprintf(&out[old], n + 1, spec.c_str(), value);
+  out.resize(old + n);
+}
+
+// printf 的数值参数：支持 0x/0 前缀以及 'c 形式的字符编码。失败时 ok 置为 false
+long long ParseNumber(std::string_view arg, bool &ok) {
+  if (arg.empty()) {
+    return 0;
+  }
+  if (arg[0] == '\'' || arg[0] == '"') {
+    return arg.size() > 1 ? static_cast<unsigned char>(arg[1]) : 0;
+  }
+  std::string s(arg);
+  char *end;
+  errno = 0;
+  long long value = strtoll(s.c_str(), &end, 0);
+  if (*end != '\0' || errno != 0) {
+    std::cerr << "printf: " << arg << ": invalid number" << std::endl;
+    ok = false;
+  }
+  return value;
+}
+
+// test/[ 的表达式求值，遵循 POSIX 按参数个数消除歧义的规则，
+// 参数多于 4 个时按 ! > -a > -o 的优先级递归下降解析
+class TestExpr {
+public:
+  TestExpr(const BuiltinArgs &args, size_t begin, size_t end)
+      : args_(args), pos_(begin), end_(end) {}
+
+  // 语法错误时返回 false，错误信息在 error 中
+  bool Evaluate(bool &result) {
+    result = EvalCount(pos_, end_);
+    return error.empty();
+  }
+
+  std::string error;
+
+private:
+  static bool IsUnary(std::string_view op) {
+    return op.size() == 2 && op[0] == '-' && strchr("bcdefghknprsStuwxzLOG", op[1]) != nullptr;
+  }
+
+  static bool IsBinary(std::string_view op) {
+    return op == "=" || op == "==" || op == "!=" || op == "<" || op == ">" ||
+           op == "-eq" || op == "-ne" || op == "-lt" || op == "-le" ||
+           op == "-gt" || op == "-ge" || op == "-nt" || op == "-ot" ||
+           op == "-ef";
+  }
+
+  bool EvalCount(size_t b, size_t e) {
+    switch (e - b) {
+    case 0:
+      return false;
+    case 1:
+      return !args_[b].empty();
+    case 2:
+      if (args_[b] == "!") {
+        return args_[b + 1].empty();
+      }
+      if (IsUnary(args_[b])) {
+        return Unary(args_[b], args_[b + 1]);
+      }
+      break;
+    case 3:
+      if (IsBinary(args_[b + 1])) {
+        return Binary(args_[b], args_[b + 1], args_[b + 2]);
+      }
+      if (args_[b] == "!") {
+        return !EvalCount(b + 1, e);
+      }
+      if (args_[b] == "(" && args_[e - 1] == ")") {
+        return !args_[b + 1].empty();
+      }
+      break;
+    case 4:
+      if (args_[b] == "!") {
+        return !EvalCount(b + 1, e);
+      }
+      if (args_[b] == "(" && args_[e - 1] == ")") {
+        return EvalCount(b + 1, e - 1);
+      }
+      break;
+    default:
+      break;
+    }
+
+    pos_ = b;
+    end_ = e;
+    bool result = Or();
+    if (error.empty() && pos_ != end_) {
+      error = std::string(args_[pos_]) + ": unexpected argument";
+    }
+    return result;
+  }
+
+  bool Or() {
+    bool result = And();
+    while (error.empty() && pos_ < end_ && args_[pos_] == "-o") {
+      ++pos_;
+      bool rhs = And();
+      result = result || rhs;
+    }
+    return result;
+  }
+
+  bool And() {
+    bool result = Not();
+    while (error.empty() && pos_ < end_ && args_[pos_] == "-a") {
+      ++pos_;
+      bool rhs = Not();
+      result = result && rhs;
+    }
+    return result;
+  }
+
+  bool Not() {
+    if (pos_ < end_ && args_[pos_] == "!") {
+      ++pos_;
+      return !Not();
+    }
+    return Primary();
+  }
+
+  bool Primary() {
+    if (pos_ >= end_) {
+      error = "argument expected";
+      return false;
+    }
+    std::string_view a = args_[pos_];
+    if (a == "(") {
+      ++pos_;
+      bool result = Or();
+      if (pos_ >= end_ || args_[pos_] != ")") {
+        error = "`)' expected";
+        return false;
+      }
+      ++pos_;
+      return result;
+    }
+    if (IsUnary(a) && pos_ + 1 < end_) {
+      pos_ += 2;
+      return Unary(a, args_[pos_ - 1]);
+    }
+    if (pos_ + 2 < end_ && IsBinary(args_[pos_ + 1])) {
+      pos_ += 3;
+      return Binary(a, args_[pos_ - 2], args_[pos_ - 1]);
+    }
+    ++pos_;
+    return !a.empty();
+  }
+
+  bool Unary(std::string_view op, std::string_view arg) {
+    char c = op[1];
+    if (c == 'n') {
+      return !arg.empty();
+    }
+    if (c == 'z') {
+      return arg.empty();
+    }
+    if (c == 't') {
+      long long fd;
+      return ToInt(arg, fd) && isatty(static_cast<int>(fd));
+    }
+
+    std::string path(arg);
+    struct stat st;
+    if ((c == 'h' || c == 'L') ? lstat(path.c_str(), &st) != 0
+                               : stat(path.c_str(), &st) != 0) {
+      return false;
+    }
+    switch (c) {
+    case 'b':
+      return S_ISBLK(st.st_mode);
+    case 'c':
+      return S_ISCHR(st.st_mode);
+    case 'd':
+      return S_ISDIR(st.st_mode);
+    case 'e':
+      return true;
+    case 'f':
+      return S_ISREG(st.st_mode);
+    case 'g':
+      return (st.st_mode & S_ISGID) != 0;
+    case 'h':
+    case 'L':
+      return S_ISLNK(st.st_mode);
+    case 'k':
+      return (st.st_mode & S_ISVTX) != 0;
+    case 'p':
+      return S_ISFIFO(st.st_mode);
+    case 'r':
+      return access(path.c_str(), R_OK) == 0;
+    case 's':
+      return st.st_size > 0;
+    case 'S':
+      return S_ISSOCK(st.st_mode);
+    case 'u':
+      return (st.st_mode & S_ISUID) != 0;
+    case 'w':
+      return access(path.c_str(), W_OK) == 0;
+    case 'x':
+      return access(path.c_str(), X_OK) == 0;
+    case 'O':
+      return st.st_uid == geteuid();
+    case 'G':
+      return st.st_gid == getegid();
+    default:
+      return false;
+    }
+  }
+
+  bool Binary(std::string_view lhs, std::string_view op, std::string_view rhs) {
+    if (op == "=" || op == "==") {
+      return lhs == rhs;
+    }
+    if (op == "!=") {
+      return lhs != rhs;
+    }
+    if (op == "<") {
+      return lhs < rhs;
+    }
+    if (op == ">") {
+      return lhs > rhs;
+    }
+    if (op == "-nt" || op == "-ot" || op == "-ef") {
+      struct stat a, b;
+      bool hasA = stat(std::string(lhs).c_str(), &a) == 0;
+      bool hasB = stat(std::string(rhs).c_str(), &b) == 0;
+      if (op == "-ef") {
+        return hasA && hasB && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+      }
+      if (!hasA || !hasB) {
+        return op == "-nt" ? hasA : hasB;
+      }
+      auto mtime = [](const struct stat &st) {
+        return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+      };
+      return op == "-nt" ? mtime(a) > mtime(b) : mtime(a) < mtime(b);
+    }
+
+    long long x, y;
+    if (!ToInt(lhs, x) || !ToInt(rhs, y)) {
+      return false;
+    }
+    if (op == "-eq") {
+      return x == y;
+    }
+    if (op == "-ne") {
+      return x != y;
+    }
+    if (op == "-lt") {
+      return x < y;
+    }
+    if (op == "-le") {
+      return x <= y;
+    }
+    if (op == "-gt") {
+      return x > y;
+    }
+    return x >= y; // -ge
+  }
+
+  bool ToInt(std::string_view arg, long long &value) {
+    std::string s(arg);
+    char *end;
+    errno = 0;
+    value = strtoll(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0' || errno != 0) {
+      if (error.empty()) {
+        error = s + ": integer expression expected";
+      }
+      return false;
+    }
+    return true;
+  }
+
+  const BuiltinArgs &args_;
+  size_t pos_;
+  size_t end_;
+};
+
+} // namespace
+
+BuiltinFn FindBuiltin(std::string_view name) {
+  for (const Entry &entry : builtins) {
+    if (name == entry.name) {
+      return entry.fn;
+    }
+  }
+  return nullptr;
+}
+
+// echo [-neE] [arg...]
+int BuiltinEcho(const BuiltinArgs &args) {
+  bool newline = true;
+  bool escapes = false;
+  size_t i = 1;
+  for (; i < args.size(); i++) {
+    std::string_view a = args[i];
+    if (a.size() < 2 || a[0] != '-' ||
+        a.find_first_not_of("neE", 1) != std::string_view::npos) {
+      break;
+    }
+    for (char c : a.substr(1)) {
+      if (c == 'n') {
+        newline = false;
+      } else {
+        escapes = c == 'e';
+      }
+    }
+  }
+
+  std::string out;
+  for (size_t first = i; i < args.size(); i++) {
+    if (i > first) {
+      out += ' ';
+    }
+    if (!escapes) {
+      out += args[i];
+    } else if (!AppendEscaped(out, args[i], false)) {
+      // \c：不再输出任何内容，包括换行
+      newline = false;
+      break;
+    }
+  }
+  if (newline) {
+    out += '\n';
+  }
+  std::cout << out;
+  return 0;
+}
+
+// printf format [arg...]，参数多于格式中的转换时重复使用格式
+int BuiltinPrintf(const BuiltinArgs &args) {
+  if (args.size() < 2) {
+    std::cerr << "printf: usage: printf format [arguments]" << std::endl;
+    return 2;
+  }
+
+  std::string_view fmt = args[1];
+  size_t argi = 2;
+  std::string out;
+  bool ok = true;
+  bool stop = false;
+
+  do {
+    size_t consumed = argi;
+    for (size_t i = 0; i < fmt.size() && !stop; i++) {
+      char c = fmt[i];
+      if (c == '\\') {
+        i = AppendEscape(out, fmt, i, true, stop);
+        continue;
+      }
+      if (c != '%') {
+        out += c;
+        continue;
+      }
+      if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+        out += '%';
+        ++i;
+        continue;
+      }
+
+      // 标志、宽度和精度原样交给 snprintf
+      size_t j = i + 1;
+      while (j < fmt.size() && strchr("-+ #0", fmt[j]) != nullptr) {
+        ++j;
+      }
+      while (j < fmt.size() && isdigit(static_cast<unsigned char>(fmt[j]))) {
+        ++j;
+      }
+      if (j < fmt.size() && fmt[j] == '.') {
+        ++j;
+        while (j < fmt.size() && isdigit(static_cast<unsigned char>(fmt[j]))) {
+          ++j;
+        }
+      }
+      if (j >= fmt.size()) {
+        std::cerr << "printf: `" << fmt.substr(i) << "': missing format character"
+                  << std::endl;
+        std::cout << out;
+        return 1;
+      }
+
+      std::string spec(fmt.substr(i, j - i));
+      char conv = fmt[j];
+      std::string_view arg = argi < args.size() ? args[argi] : std::string_view();
+      switch (conv) {
+      case 's':
+        AppendFormat(out, spec + 's', std::string(arg).c_str());
+        break;
+      case 'b': {
+        std::string expanded;
+        stop = !AppendEscaped(expanded, arg, false);
+        AppendFormat(out, spec + 's', expanded.c_str());
+        break;
+      }
+      case 'c':
+        if (!arg.empty()) {
+          AppendFormat(out, spec + 'c', arg[0]);
+        }
+        break;
+      case 'd':
+      case 'i':
+        AppendFormat(out, spec + "lld", ParseNumber(arg, ok));
+        break;
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        AppendFormat(out, spec + "ll" + conv,
+                     static_cast<unsigned long long>(ParseNumber(arg, ok)));
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        AppendFormat(out, spec + conv, strtod(std::string(arg).c_str(), nullptr));
+        break;
+      default:
+        std::cerr << "printf: `" << conv << "': invalid format character"
+                  << std::endl;
+        std::cout << out;
+        return 1;
+      }
+      if (argi < args.size()) {
+        ++argi;
+      }
+      i = j;
+    }
+    // 没有消耗任何参数时不再重复，避免死循环
+    if (argi == consumed) {
+      break;
+    }
+  } while (argi < args.size() && !stop);
+
+  std::cout << out;
+  return ok ? 0 : 1;
+}
+
+// test expr / [ expr ]：真返回 0，假返回 1，语法错误返回 2
+int BuiltinTest(const BuiltinArgs &args) {
+  size_t end = args.size();
+  if (args[0] == "[") {
+    if (args.back() != "]") {
+      std::cerr << "[: missing `]'" << std::endl;
+      return 2;
+    }
+    --end;
+  }
+
+  TestExpr expr(args, 1, end);
+  bool result;
+  if (!expr.Evaluate(result)) {
+    std::cerr << args[0] << ": " << expr.error << std::endl;
+    return 2;
+  }
+  return result ? 0 : 1;
+}
+
+int BuiltinTrue(const BuiltinArgs &) { return 0; }
+
+int BuiltinFalse(const BuiltinArgs &) { return 1; }
+
+// read [-r] [name...]：从 fd 0 读一行，按空白分割后存入环境变量，没有给出名字时存入 REPLY。
+// 逐字节读取，不会多读属于后续命令的输入
+int BuiltinRead(const BuiltinArgs &args) {
+  bool raw = false;
+  size_t i = 1;
+  if (i < args.size() && args[i] == "-r") {
+    raw = true;
+    ++i;
+  }
+
+  std::string line;
+  bool eof = false;
+  while (true) {
+    char c;
+    ssize_t n = read(0, &c, 1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      eof = true;
+      break;
+    }
+    if (c == '\n') {
+      break;
+    }
+    if (c == '\\' && !raw) {
+      n = read(0, &c, 1);
+      if (n <= 0) {
+        eof = true;
+        break;
+      }
+      // 反斜杠加换行表示续行
+      if (c == '\n') {
+        continue;
+      }
+    }
+    line += c;
+  }
+  if (eof && line.empty()) {
+    return 1;
+  }
+
+  if (i == args.size()) {
+    setenv("REPLY", line.c_str(), 1);
+    return eof ? 1 : 0;
+  }
+
+  const char *blanks = " \t\n";
+  size_t pos = line.find_first_not_of(blanks);
+  for (; i < args.size(); i++) {
+    std::string name(args[i]);
+    std::string value;
+    if (pos != std::string::npos) {
+      if (i + 1 == args.size()) {
+        // 最后一个名字得到剩下的全部内容（去掉末尾空白）
+        size_t last = line.find_last_not_of(blanks);
+        value = line.substr(pos, last - pos + 1);
+        pos = std::string::npos;
+      } else {
+        size_t end = line.find_first_of(blanks, pos);
+        value = line.substr(pos, end == std::string::npos ? end : end - pos);
+        pos = end == std::string::npos ? end : line.find_first_not_of(blanks, end);
+      }
+    }
+    setenv(name.c_str(), value.c_str(), 1);
+  }
+  return eof ? 1 : 0;
+}
+
+int BuiltinPwd(const BuiltinArgs &) {
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, PATH_MAX) != NULL) {
+    std::cout << cwd << "\n";
+    return 0;
+  }
+  std::cout << "Error getting current directory\n";
+  return 1;
+}
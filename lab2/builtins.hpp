@@ -0,0 +1,42 @@
+#ifndef BUILTINS_HPP
+#define BUILTINS_HPP
+
+// std::pmr::polymorphic_allocator
+#include <memory_resource>
+// std::string_view
+#include <string_view>
+// std::pmr::vector
+#include <vector>
+
+// 内建命令的参数，args[0] 为命令名
+using BuiltinArgs = std::pmr::vector<std::string_view>;
+
+// 内建命令在 shell 进程（或为它 fork 出的子进程）中直接执行，返回退出状态。
+// 执行前调用者已经把重定向和管道 dup2 到 fd 0/1/2：输出写 std::cout/std::cerr，
+// 调用者负责在恢复 fd 之前刷新；输入直接 read(0)，不经过 std::cin 的缓冲区。
+using BuiltinFn = int (*)(const BuiltinArgs &args);
+
+// 查找内建命令，不是内建命令时返回 nullptr
+BuiltinFn FindBuiltin(std::string_view name);
+
+// 只依赖参数和 fd 的内建命令，定义在 builtins.cpp
+int BuiltinEcho(const BuiltinArgs &args);
+int BuiltinPrintf(const BuiltinArgs &args);
+int BuiltinTest(const BuiltinArgs &args);
+int BuiltinTrue(const BuiltinArgs &args);
+int BuiltinFalse(const BuiltinArgs &args);
+int BuiltinRead(const BuiltinArgs &args);
+int BuiltinPwd(const BuiltinArgs &args);
+
+// 需要访问 shell 状态（作业表、命令缓存等）的内建命令，定义在 shell.cpp
+int BuiltinExit(const BuiltinArgs &args);
+int BuiltinCd(const BuiltinArgs &args);
+int BuiltinWait(const BuiltinArgs &args);
+int BuiltinHash(const BuiltinArgs &args);
+int BuiltinJobs(const BuiltinArgs &args);
+int BuiltinFg(const BuiltinArgs &args);
+int BuiltinBg(const BuiltinArgs &args);
+int BuiltinParallel(const BuiltinArgs &args);
+int BuiltinSet(const BuiltinArgs &args);
+
+#endif // BUILTINS_HPP
@@ -0,0 +1,94 @@
+#include "cmdhash.hpp"
+
+// getenv
+#include <cstdlib>
+// strchr
+#include <cstring>
+// POSIX API
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char *CommandHash::Lookup(const char *name) {
+  if (strchr(name, '/') != nullptr) {
+    return name;
+  }
+
+  CheckPath();
+  std::string key(name);
+  auto it = table_.find(key);
+  if (it == table_.end()) {
+    std::string path;
+    if (!Search(name, path_, path)) {
+      return nullptr;
+    }
+    it = table_.emplace(std::move(key), Entry{std::move(path), 0}).first;
+  }
+  ++it->second.hits;
+  return it->second.path.c_str();
+}
+
+bool CommandHash::Add(std::string_view name) {
+  if (name.find('/') != std::string_view::npos) {
+    return true;
+  }
+
+  CheckPath();
+  std::string path;
+  if (!Search(name, path_, path)) {
+    return false;
+  }
+  table_[std::string(name)] = Entry{std::move(path), 0};
+  return true;
+}
+
+void CommandHash::Forget(std::string_view name) {
+  table_.erase(std::string(name));
+}
+
+void CommandHash::Clear() { table_.clear(); }
+
+void CommandHash::Print(std::ostream &os) const {
+  if (table_.empty()) {
+    os << "hash: hash table empty\n";
+    return;
+  }
+  os << "hits\tcommand\n";
+  for (const auto &[name, entry] : table_) {
+    os << "   " << entry.hits << "\t" << entry.path << "\n";
+  }
+}
+
+void CommandHash::CheckPath() {
+  const char *path = getenv("PATH");
+  if (path == nullptr) {
+    path = "";
+  }
+  if (path_ != path) {
+    table_.clear();
+    path_ = path;
+  }
+}
+
+bool CommandHash::Search(std::string_view name, const std::string &pathVar,
+                         std::string &result) {
+  size_t begin = 0;
+  while (begin <= pathVar.size()) {
+    size_t end = pathVar.find(':', begin);
+    if (end == std::string::npos) {
+      end = pathVar.size();
+    }
+    // PATH 中的空项表示当前目录
+    std::string_view dir(pathVar.data() + begin, end - begin);
+    result.assign(dir.empty() ? std::string_view(".") : dir);
+    result += '/';
+    result += name;
+
+    struct stat st;
+    if (stat(result.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+        access(result.c_str(), X_OK) == 0) {
+      return true;
+    }
+    begin = end + 1;
+  }
+  return false;
+}
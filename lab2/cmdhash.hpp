@@ -0,0 +1,54 @@
+#ifndef CMDHASH_HPP
+#define CMDHASH_HPP
+
+// std::ostream
+#include <ostream>
+// std::string
+#include <string>
+// std::string_view
+#include <string_view>
+// std::unordered_map
+#include <unordered_map>
+
+// 命令名到绝对路径的缓存，对应 bash 的 hash 表。
+// 每个命令名只在 PATH 中搜索一次，之后直接用绝对路径执行，
+// 省去 execvp 对 PATH 中每个靠前目录的一次失败的 execve。
+// PATH 改变时整张表失效；缓存的文件消失时由调用者用 Forget() 删除对应项。
+class CommandHash {
+public:
+  // 返回命令的绝对路径；name 含 '/' 时原样返回，找不到时返回 nullptr。
+  // 返回的指针在下一次修改表之前有效
+  const char *Lookup(const char *name);
+
+  // 解析 name 并加入缓存，找不到时返回 false
+  bool Add(std::string_view name);
+
+  // 删除一项，下次 Lookup 会重新搜索 PATH
+  void Forget(std::string_view name);
+
+  // 清空整张表
+  void Clear();
+
+  // 按 bash 的格式列出缓存的命令及命中次数
+  void Print(std::ostream &os) const;
+
+  bool Empty() const { return table_.empty(); }
+
+private:
+  struct Entry {
+    std::string path;
+    unsigned hits;
+  };
+
+  // PATH 与建表时不同则清空表
+  void CheckPath();
+
+  // 在 PATH 中搜索可执行的普通文件
+  static bool Search(std::string_view name, const std::string &pathVar,
+                     std::string &result);
+
+  std::unordered_map<std::string, Entry> table_;
+  std::string path_; // 建表时的 PATH
+};
+
+#endif // CMDHASH_HPP
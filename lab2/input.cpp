@@ -0,0 +1,169 @@
+#include "input.hpp"
+
+// std::min
+#include <algorithm>
+// errno
+#include <cerrno>
+// memcpy
+#include <cstring>
+// POSIX API
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+StreamSource::StreamSource(int fd) : fd_(fd) {
+  struct stat st;
+  if (isatty(fd)) {
+    chunk_ = 4096;
+  } else if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+             lseek(fd, 0, SEEK_CUR) != -1) {
+    seekable_ = true;
+    chunk_ = 4096;
+  }
+}
+
+bool StreamSource::GetLine(std::string &out) {
+  out.clear();
+  char buf[4096];
+  while (true) {
+    ssize_t n = read(fd_, buf, chunk_);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return !out.empty();
+    }
+    const void *nl = memchr(buf, '\n', n);
+    if (nl == nullptr) {
+      out.append(buf, n);
+      continue;
+    }
+    size_t len = static_cast<const char *>(nl) - buf;
+    out.append(buf, len);
+    // 退回多读的部分，留给后续命令
+    if (seekable_ && len + 1 < static_cast<size_t>(n)) {
+      lseek(fd_, static_cast<off_t>(len + 1) - n, SEEK_CUR);
+    }
+    return true;
+  }
+}
+
+bool StreamSource::NextLine(std::string_view &line) {
+  if (!GetLine(line_)) {
+    return false;
+  }
+  ++lineno_;
+  line = line_;
+  return true;
+}
+
+bool StreamSource::ReadHereDoc(std::string_view delim, Arena &arena,
+                               std::string_view &body) {
+  body_.clear();
+  bool closed = false;
+  std::string text;
+  while (GetLine(text)) {
+    ++lineno_;
+    if (text == delim) {
+      closed = true;
+      break;
+    }
+    body_ += text;
+    body_ += '\n';
+  }
+  // 下一行命令会覆盖缓冲区，正文复制到本行的 arena 中
+  char *buf = arena.AllocChars(body_.size());
+  memcpy(buf, body_.data(), body_.size());
+  body = std::string_view(buf, body_.size());
+  return closed;
+}
+
+ScriptSource::~ScriptSource() {
+  if (map_ != nullptr) {
+    munmap(map_, size_);
+  }
+}
+
+bool ScriptSource::Load(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      close(fd);
+      map_ = p;
+      data_ = static_cast<const char *>(p);
+      size_ = st.st_size;
+      return true;
+    }
+  }
+
+  // 不能映射（管道、/dev/stdin 等）时按 1MiB 一块读入
+  owned_.clear();
+  size_t len = 0;
+  while (true) {
+    owned_.resize(len + (1 << 20));
+    ssize_t n = read(fd, &owned_[len], owned_.size() - len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int saved = errno;
+      close(fd);
+      errno = saved;
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    len += n;
+  }
+  close(fd);
+  owned_.resize(len);
+  data_ = owned_.data();
+  size_ = owned_.size();
+  return true;
+}
+
+void ScriptSource::SetText(std::string text) {
+  owned_ = std::move(text);
+  data_ = owned_.data();
+  size_ = owned_.size();
+  pos_ = 0;
+}
+
+bool ScriptSource::NextLine(std::string_view &line) {
+  if (pos_ >= size_) {
+    return false;
+  }
+  const void *nl = memchr(data_ + pos_, '\n', size_ - pos_);
+  size_t end = nl != nullptr ? static_cast<const char *>(nl) - data_ : size_;
+  line = std::string_view(data_ + pos_, end - pos_);
+  pos_ = end + 1;
+  ++lineno_;
+  return true;
+}
+
+bool ScriptSource::ReadHereDoc(std::string_view delim, Arena &,
+                               std::string_view &body) {
+  // 正文在脚本中本来就是连续的，直接指向原文
+  size_t start = std::min(pos_, size_);
+  std::string_view line;
+  while (true) {
+    size_t lineStart = pos_;
+    if (!NextLine(line)) {
+      body = std::string_view(data_ + start, size_ - start);
+      return false;
+    }
+    if (line == delim) {
+      body = std::string_view(data_ + start, lineStart - start);
+      return true;
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+// std::string
+#include <string>
+// std::string_view
+#include <string_view>
+
+#include "parser.hpp"
+
+// 命令行的来源：交互模式下是标准输入，脚本模式下是整个读入内存的脚本
+class LineSource {
+public:
+  virtual ~LineSource() = default;
+
+  // 读入下一行命令（不含换行符），内容在下一次调用 NextLine 之前有效。输入结束返回 false
+  virtual bool NextLine(std::string_view &line) = 0;
+
+  // 读入 here-doc 的正文，直到只含 delim 的一行（不包含该行）。
+  // 正文的内存在本行命令执行完之前有效。遇到输入结束时返回 false，body 为已读到的部分
+  virtual bool ReadHereDoc(std::string_view delim, Arena &arena,
+                           std::string_view &body) = 0;
+
+  // 最近读入的一行的行号，从 1 开始
+  size_t lineno() const { return lineno_; }
+
+protected:
+  size_t lineno_ = 0;
+};
+
+// 从 fd 逐行读入，用于交互模式（标准输入）。
+// 命令和内建命令 read、外部命令共用同一个 fd，因此不能像 std::cin 那样多读：
+// 终端一次 read 最多返回一行，可以整块读；普通文件整块读入后用 lseek 退回到行尾之后；
+// 管道等不能退回的文件只能逐字节读
+class StreamSource : public LineSource {
+public:
+  explicit StreamSource(int fd);
+
+  bool NextLine(std::string_view &line) override;
+  bool ReadHereDoc(std::string_view delim, Arena &arena,
+                   std::string_view &body) override;
+
+private:
+  // 读入一行到 out（不含换行符），输入结束且没有读到任何内容时返回 false
+  bool GetLine(std::string &out);
+
+  int fd_;
+  bool seekable_ = false;
+  size_t chunk_ = 1; // 每次 read 的字节数
+  std::string line_;
+  std::string body_;
+};
+
+// 整个脚本一次读入内存，行和 here-doc 正文都是指向这块内存的 string_view，不再复制。
+// 普通文件用 mmap 映射并提示内核顺序读；管道等其他文件用大块 read 读入
+class ScriptSource : public LineSource {
+public:
+  ScriptSource() = default;
+  ~ScriptSource();
+  ScriptSource(const ScriptSource &) = delete;
+  ScriptSource &operator=(const ScriptSource &) = delete;
+
+  // 读入脚本文件，失败返回 false 并设置 errno
+  bool Load(const char *path);
+
+  // 使用给定的文本（shell -c）
+  void SetText(std::string text);
+
+  bool NextLine(std::string_view &line) override;
+  bool ReadHereDoc(std::string_view delim, Arena &arena,
+                   std::string_view &body) override;
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+  void *map_ = nullptr; // mmap 得到的地址，未映射时为 nullptr
+  std::string owned_;   // 非 mmap 时保存脚本内容
+};
+
+#endif // INPUT_HPP
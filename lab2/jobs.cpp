@@ -0,0 +1,283 @@
+#include "jobs.hpp"
+
+// errno
+#include <cerrno>
+// atoi
+#include <cstdlib>
+// strsignal
+#include <cstring>
+// std::setw
+#include <iomanip>
+// POSIX API
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+int sigchld_wfd = -1; // self-pipe 写端，供信号处理函数使用
+
+void sigchld_handler(int) {
+  int saved = errno;
+  // 管道满时写入失败也没关系，读端已经有数据待处理
+  (void)!write(sigchld_wfd, "c", 1);
+  errno = saved;
+}
+
+const char *StateName(const Job *job) {
+  switch (job->State()) {
+  case JobState::Running:
+    return "Running";
+  case JobState::Stopped:
+    return "Stopped";
+  case JobState::Done:
+    break;
+  }
+  int status = job->LastStatus();
+  if (WIFSIGNALED(status)) {
+    return strsignal(WTERMSIG(status));
+  }
+  return WEXITSTATUS(status) == 0 ? "Done" : "Exit";
+}
+
+} // namespace
+
+void JobTable::Init() {
+  int fds[2];
+  if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+    return;
+  }
+  // 移到 10 以上，与 SaveFd 一样避开用户重定向能用到的 0-9，
+  // 否则在 shell 进程中执行的内建命令的重定向会覆盖 self-pipe
+  for (int i = 0; i < 2; i++) {
+    sigpipe_[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, 10);
+    close(fds[i]);
+  }
+  if (sigpipe_[0] == -1 || sigpipe_[1] == -1) {
+    return;
+  }
+  sigchld_wfd = sigpipe_[1];
+
+  struct sigaction sa;
+  sa.sa_handler = sigchld_handler;
+  sigemptyset(&sa.sa_mask);
+  // SA_RESTART：读命令行时不会因为子进程结束而被打断
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGCHLD, &sa, nullptr);
+}
+
+Job *JobTable::Add(pid_t pgid, const std::vector<pid_t> &pids,
+                   std::string_view cmdline, bool background) {
+  int id = jobs_.empty() ? 1 : jobs_.rbegin()->first + 1;
+  auto job = std::make_unique<Job>();
+  job->id = id;
+  job->pgid = pgid;
+  job->cmdline.assign(cmdline);
+  job->procs.reserve(pids.size());
+  for (pid_t pid : pids) {
+    job->procs.push_back({pid});
+  }
+  job->alive = pids.size();
+  job->background = background;
+
+  Job *raw = job.get();
+  for (size_t i = 0; i < pids.size(); i++) {
+    byPid_[pids[i]] = {raw, i};
+  }
+  jobs_.emplace(id, std::move(job));
+  if (background) {
+    MakeCurrent(id);
+  }
+  return raw;
+}
+
+Job *JobTable::Find(std::string_view spec) {
+  int id;
+  if (spec.empty() || spec == "%+" || spec == "%%" || spec == "%") {
+    id = current_;
+  } else if (spec == "%-") {
+    id = previous_;
+  } else if (spec[0] == '%') {
+    id = atoi(std::string(spec.substr(1)).c_str());
+  } else {
+    // 进程 pid
+    auto it = byPid_.find(atoi(std::string(spec).c_str()));
+    return it == byPid_.end() ? nullptr : it->second.first;
+  }
+  auto it = jobs_.find(id);
+  return it == jobs_.end() ? nullptr : it->second.get();
+}
+
+void JobTable::Reap() {
+  char buf[256];
+  bool signaled = false;
+  while (read(sigpipe_[0], buf, sizeof(buf)) > 0) {
+    signaled = true;
+  }
+  if (!signaled) {
+    return;
+  }
+
+  int status;
+  struct rusage usage;
+  pid_t pid;
+  while ((pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage)) >
+         0) {
+    Update(pid, status, usage);
+  }
+}
+
+void JobTable::Notify(std::ostream &os) {
+  for (int id : pending_) {
+    auto it = jobs_.find(id);
+    if (it == jobs_.end() || !it->second->background) {
+      continue;
+    }
+    Job *job = it->second.get();
+    JobState state = job->State();
+    if (state == JobState::Running) {
+      continue;
+    }
+    Print(os, job);
+    if (state == JobState::Done) {
+      Remove(job);
+    }
+  }
+  pending_.clear();
+}
+
+void JobTable::Prune() {
+  for (int id : pending_) {
+    auto it = jobs_.find(id);
+    if (it != jobs_.end() && it->second->background &&
+        it->second->State() == JobState::Done) {
+      Remove(it->second.get());
+    }
+  }
+  pending_.clear();
+}
+
+void JobTable::WaitForeground(Job *job, bool cont) {
+  tcsetpgrp(0, job->pgid); // 将前台进程组设置为管道的进程组
+  if (cont) {
+    Continue(job);
+  }
+  job->background = false;
+
+  while (job->State() == JobState::Running) {
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-job->pgid, &status, WUNTRACED, &usage);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    Update(pid, status, usage);
+  }
+
+  tcsetpgrp(0, getpgrp()); // 将前台进程组设置为shell进程的进程组
+  if (job->State() == JobState::Stopped) {
+    // 被 Ctrl+Z 停止的前台 job 留在表中，之后可以用 fg/bg 继续
+    job->background = true;
+    MakeCurrent(job->id);
+  }
+}
+
+void JobTable::Wait(Job *job) {
+  while (job->alive > 0) {
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-job->pgid, &status, 0, &usage);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    Update(pid, status, usage);
+  }
+}
+
+void JobTable::Continue(Job *job) {
+  for (Process &p : job->procs) {
+    p.stopped = false;
+  }
+  job->stopped = 0;
+  kill(-job->pgid, SIGCONT);
+}
+
+void JobTable::Remove(Job *job) {
+  for (const Process &p : job->procs) {
+    if (!p.done) {
+      byPid_.erase(p.pid);
+    }
+  }
+  int id = job->id;
+  jobs_.erase(id);
+  if (current_ == id) {
+    current_ = jobs_.count(previous_) ? previous_ : 0;
+    previous_ = 0;
+  } else if (previous_ == id) {
+    previous_ = 0;
+  }
+}
+
+void JobTable::Print(std::ostream &os, const Job *job) const {
+  char mark = job->id == current_ ? '+' : job->id == previous_ ? '-' : ' ';
+  os << "[" << job->id << "]" << mark << "  " << std::left << std::setw(24)
+     << StateName(job) << job->cmdline;
+  if (job->State() == JobState::Running) {
+    os << " &";
+  }
+  os << std::right << "\n";
+}
+
+void JobTable::Update(pid_t pid, int status, const struct rusage &usage) {
+  auto it = byPid_.find(pid);
+  if (it == byPid_.end()) {
+    return;
+  }
+  Job *job = it->second.first;
+  Process &p = job->procs[it->second.second];
+  JobState before = job->State();
+
+  if (WIFSTOPPED(status)) {
+    if (!p.stopped) {
+      p.stopped = true;
+      ++job->stopped;
+    }
+  } else if (WIFCONTINUED(status)) {
+    if (p.stopped) {
+      p.stopped = false;
+      --job->stopped;
+    }
+  } else {
+    p.status = status;
+    p.usage = usage;
+    clock_gettime(CLOCK_MONOTONIC, &p.end);
+    p.done = true;
+    if (p.stopped) {
+      p.stopped = false;
+      --job->stopped;
+    }
+    --job->alive;
+    byPid_.erase(it);
+  }
+
+  JobState after = job->State();
+  if (job->background && after != before && after != JobState::Running) {
+    pending_.push_back(job->id);
+  }
+}
+
+void JobTable::MakeCurrent(int id) {
+  if (current_ != id) {
+    previous_ = current_;
+    current_ = id;
+  }
+}
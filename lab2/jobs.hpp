@@ -0,0 +1,115 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+// std::map
+#include <map>
+// std::unique_ptr
+#include <memory>
+// std::ostream
+#include <ostream>
+// std::string
+#include <string>
+// std::string_view
+#include <string_view>
+// std::unordered_map
+#include <unordered_map>
+// std::vector
+#include <vector>
+// struct rusage
+#include <sys/resource.h>
+// pid_t
+#include <sys/types.h>
+// struct timespec
+#include <time.h>
+
+enum class JobState { Running, Stopped, Done };
+
+// job 中的一个进程（管道的一段）
+struct Process {
+  pid_t pid;
+  int status = 0; // wait4 得到的最终状态
+  bool done = false;
+  bool stopped = false;
+  struct rusage usage {}; // wait4 得到的资源使用情况
+  struct timespec end {}; // 被回收的时刻（CLOCK_MONOTONIC）
+};
+
+// 一条管道对应一个 job，所有进程在同一个进程组中
+struct Job {
+  int id;
+  pid_t pgid;
+  std::string cmdline;
+  std::vector<Process> procs;
+  size_t alive;       // 尚未结束的进程数
+  size_t stopped = 0; // 处于停止状态的进程数
+  bool background;
+
+  JobState State() const {
+    if (alive == 0) {
+      return JobState::Done;
+    }
+    return stopped == alive ? JobState::Stopped : JobState::Running;
+  }
+
+  // 管道的退出状态取最后一段
+  int LastStatus() const { return procs.back().status; }
+};
+
+// 作业表。子进程的回收由 SIGCHLD 驱动：信号处理函数只向 self-pipe 写一个字节，
+// Reap() 发现管道中有数据时才调用 wait4(-1, WNOHANG)，并通过 pid -> job 的哈希表
+// 以 O(1) 找到对应的进程，更新 job 中尚未结束的进程计数。
+// 没有子进程状态变化时，每次提示符前的开销只是一次失败的非阻塞 read。
+class JobTable {
+public:
+  // 创建 self-pipe 并安装 SIGCHLD 处理函数
+  void Init();
+
+  // 登记一条刚创建的管道，返回新 job
+  Job *Add(pid_t pgid, const std::vector<pid_t> &pids, std::string_view cmdline,
+           bool background);
+
+  // 解析 %n、%+、%%、%-（空串等同于 %+）或者进程 pid，找不到返回 nullptr
+  Job *Find(std::string_view spec);
+
+  // 若有 SIGCHLD 到达，回收所有状态发生变化的子进程
+  void Reap();
+
+  // 报告后台 job 的结束或停止，已结束的 job 从表中删除（在提示符前调用）
+  void Notify(std::ostream &os);
+
+  // 与 Notify 相同，但不打印，只删除已结束的后台 job（非交互模式下调用）
+  void Prune();
+
+  // 把 job 放到前台，cont 为 true 时先发送 SIGCONT。
+  // 等到 job 全部结束或停止后把终端交还给 shell
+  void WaitForeground(Job *job, bool cont);
+
+  // 阻塞等待 job 全部结束（wait 内建命令），不改变前台进程组
+  void Wait(Job *job);
+
+  // 让停止的 job 在后台继续运行
+  void Continue(Job *job);
+
+  void Remove(Job *job);
+
+  // 按 bash 的格式打印一个 job，如 "[1]+  Running    sleep 10 &"
+  void Print(std::ostream &os, const Job *job) const;
+
+  const std::map<int, std::unique_ptr<Job>> &jobs() const { return jobs_; }
+
+private:
+  // 处理一次 wait4 的结果
+  void Update(pid_t pid, int status, const struct rusage &usage);
+
+  // 把 job 设为 %+
+  void MakeCurrent(int id);
+
+  std::map<int, std::unique_ptr<Job>> jobs_; // 按编号有序，便于 jobs 输出
+  std::unordered_map<pid_t, std::pair<Job *, size_t>> byPid_; // pid -> (job, 下标)
+  std::vector<int> pending_; // 状态发生变化、等待报告的后台 job 编号
+  int current_ = 0;          // %+
+  int previous_ = 0;         // %-
+  int sigpipe_[2] = {-1, -1};
+};
+
+#endif // JOBS_HPP
@@ -0,0 +1,246 @@
+#include "parallel.hpp"
+
+// std::max, std::remove_if
+#include <algorithm>
+// errno
+#include <cerrno>
+// SIZE_MAX
+#include <cstdint>
+// strerror
+#include <cstring>
+// IO
+#include <iostream>
+// POSIX API
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spawn.hpp"
+
+namespace {
+
+// 分组模式下已结束、尚未输出的任务最多保留这么多个，
+// 避免队头的任务很慢时 memfd 无限增多
+const size_t kMinWindow = 256;
+
+// 把 fd 的全部内容复制到标准输出。memfd 支持 sendfile，数据不经过用户态
+void CopyToStdout(int fd) {
+  off_t off = 0;
+  while (true) {
+    ssize_t n = sendfile(1, fd, &off, 1 << 20);
+    if (n > 0) {
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n == 0 || (errno != EINVAL && errno != ENOSYS)) {
+      return;
+    }
+    break;
+  }
+
+  // 标准输出不支持 sendfile 时退回到 read/write
+  char buf[65536];
+  ssize_t n;
+  while ((n = pread(fd, buf, sizeof(buf), off)) > 0) {
+    off += n;
+    for (ssize_t done = 0; done < n;) {
+      ssize_t w = write(1, buf + done, n - done);
+      if (w < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return;
+      }
+      done += w;
+    }
+  }
+}
+
+} // namespace
+
+ParallelRunner::ParallelRunner(CommandHash &hash, std::vector<std::string> tmpl,
+                               size_t maxJobs, bool group)
+    : hash_(hash), tmpl_(std::move(tmpl)), hasPlaceholder_(false),
+      maxJobs_(std::max<size_t>(maxJobs, 1)), group_(group) {
+  for (const std::string &arg : tmpl_) {
+    hasPlaceholder_ = hasPlaceholder_ || arg.find("{}") != std::string::npos;
+  }
+}
+
+size_t ParallelRunner::Run(int infd, char delim) {
+  infd_ = infd;
+  delim_ = delim;
+
+  // 阻塞 SIGCHLD，用 sigwaitinfo 等待它，检查和等待之间不会漏掉信号
+  sigset_t chld, old;
+  sigemptyset(&chld);
+  sigaddset(&chld, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &chld, &old);
+  bool consumed = false;
+
+  size_t window = group_ ? std::max(maxJobs_, kMinWindow) : SIZE_MAX;
+  std::string item;
+  while (true) {
+    while (!stop_ && running_ < maxJobs_ && tasks_.size() < window &&
+           NextItem(item)) {
+      Start(item);
+    }
+    Flush();
+    if (running_ == 0) {
+      break;
+    }
+    if (!ReapFinished()) {
+      siginfo_t info;
+      if (sigwaitinfo(&chld, &info) > 0) {
+        consumed = true;
+      }
+    }
+  }
+
+  // 等待期间可能取走了属于后台 job 的 SIGCHLD，恢复信号掩码前补发一次，让作业表重新检查
+  if (consumed) {
+    kill(getpid(), SIGCHLD);
+  }
+  sigprocmask(SIG_SETMASK, &old, nullptr);
+  return failed_;
+}
+
+bool ParallelRunner::NextItem(std::string &item) {
+  while (true) {
+    size_t end = buf_.find(delim_, pos_);
+    if (end == std::string::npos && eof_) {
+      end = buf_.size();
+    }
+    if (end != std::string::npos) {
+      if (pos_ >= buf_.size()) {
+        return false;
+      }
+      item.assign(buf_, pos_, end - pos_);
+      pos_ = end + 1;
+      if (item.empty()) {
+        continue;
+      }
+      return true;
+    }
+
+    // 没有完整的一项，整块读入更多数据
+    buf_.erase(0, pos_);
+    pos_ = 0;
+    char chunk[65536];
+    ssize_t n = read(infd_, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      eof_ = true;
+    } else {
+      buf_.append(chunk, n);
+    }
+  }
+}
+
+void ParallelRunner::Start(const std::string &item) {
+  std::vector<std::string> args;
+  args.reserve(tmpl_.size() + 1);
+  for (const std::string &arg : tmpl_) {
+    std::string expanded;
+    size_t from = 0, at;
+    while ((at = arg.find("{}", from)) != std::string::npos) {
+      expanded.append(arg, from, at - from);
+      expanded += item;
+      from = at + 2;
+    }
+    expanded.append(arg, from, std::string::npos);
+    args.push_back(std::move(expanded));
+  }
+  if (!hasPlaceholder_) {
+    args.push_back(item);
+  }
+  std::vector<char *> argv;
+  argv.reserve(args.size() + 1);
+  for (std::string &arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  ++started_;
+  tasks_.emplace_back();
+  Task &task = tasks_.back();
+
+  // 输入项来自标准输入，子进程不能再读它
+  SpawnPlan plan;
+  plan.Open(0, "/dev/null", O_RDONLY, 0);
+  if (group_) {
+    task.outfd = memfd_create("parallel", MFD_CLOEXEC);
+    if (task.outfd >= 0) {
+      plan.Dup2(task.outfd, 1);
+    }
+  }
+
+  const char *path = hash_.Lookup(argv[0]);
+  pid_t pid = path != nullptr ? plan.Spawn(path, argv.data()) : -1;
+  if (path == nullptr) {
+    errno = ENOENT;
+  }
+  if (pid < 0) {
+    std::cerr << "parallel: " << argv[0] << ": " << strerror(errno)
+              << std::endl;
+    // 同一个模板对后面的输入项也会失败，不再继续
+    stop_ = true;
+    Finish(task, (errno == ENOENT ? 127 : 126) << 8);
+    return;
+  }
+  task.pid = pid;
+  ++running_;
+}
+
+bool ParallelRunner::ReapFinished() {
+  bool any = false;
+  for (Task &task : tasks_) {
+    if (task.done) {
+      continue;
+    }
+    int status;
+    pid_t pid = waitpid(task.pid, &status, WNOHANG);
+    if (pid == task.pid || (pid < 0 && errno == ECHILD)) {
+      --running_;
+      Finish(task, pid < 0 ? 0 : status);
+      any = true;
+    }
+  }
+  return any;
+}
+
+void ParallelRunner::Finish(Task &task, int status) {
+  task.done = true;
+  task.status = status;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    ++failed_;
+  }
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) {
+    stop_ = true;
+  }
+}
+
+void ParallelRunner::Flush() {
+  if (!group_) {
+    // 不分组时输出已经直接写到标准输出，结束的任务随时可以释放
+    tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(),
+                                [](const Task &task) { return task.done; }),
+                 tasks_.end());
+    return;
+  }
+  while (!tasks_.empty() && tasks_.front().done) {
+    Task &task = tasks_.front();
+    if (task.outfd >= 0) {
+      CopyToStdout(task.outfd);
+      close(task.outfd);
+    }
+    tasks_.pop_front();
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+// std::deque
+#include <deque>
+// std::string
+#include <string>
+// std::vector
+#include <vector>
+// pid_t
+#include <sys/types.h>
+
+#include "cmdhash.hpp"
+
+// parallel 内建命令的执行器，相当于 xargs -P / GNU parallel 的一个子集。
+// 从 fd 中逐项读入参数，对每一项按命令模板生成一条命令，最多同时运行 maxJobs 个子进程。
+// 子进程结束时由 SIGCHLD 唤醒（sigwaitinfo），随即补上新的任务，使进程池一直是满的。
+// 分组模式下每个任务的标准输出先写进自己的 memfd，按输入顺序依次输出，互不交错。
+class ParallelRunner {
+public:
+  // tmpl 中的 "{}" 替换为输入项；没有 "{}" 时输入项作为最后一个参数
+  ParallelRunner(CommandHash &hash, std::vector<std::string> tmpl,
+                 size_t maxJobs, bool group);
+
+  // 从 infd 读入以 delim 分隔的输入项（空项跳过）并全部执行完，返回失败的任务数
+  size_t Run(int infd, char delim);
+
+  // 已启动的任务数
+  size_t started() const { return started_; }
+
+private:
+  struct Task {
+    pid_t pid = -1;
+    int outfd = -1; // 缓存标准输出的 memfd，不分组时为 -1
+    int status = 0;
+    bool done = false;
+  };
+
+  // 取下一个输入项，输入结束返回 false
+  bool NextItem(std::string &item);
+
+  // 为一个输入项启动子进程，失败时任务直接记为失败
+  void Start(const std::string &item);
+
+  // 非阻塞地回收正在运行的任务，返回是否有任务结束
+  bool ReapFinished();
+
+  // 任务结束时记录状态
+  void Finish(Task &task, int status);
+
+  // 按顺序输出已经结束的任务并释放
+  void Flush();
+
+  CommandHash &hash_;
+  std::vector<std::string> tmpl_;
+  bool hasPlaceholder_;
+  size_t maxJobs_;
+  bool group_;
+
+  int infd_ = -1;
+  char delim_ = '\n';
+  std::string buf_; // 尚未切分的输入
+  size_t pos_ = 0;
+  bool eof_ = false;
+
+  std::deque<Task> tasks_; // 按输入顺序，队头是下一个要输出的任务
+  size_t running_ = 0;
+  size_t started_ = 0;
+  size_t failed_ = 0;
+  bool stop_ = false; // 被 Ctrl+C 中断或命令无法执行时不再启动新任务
+};
+
+#endif // PARALLEL_HPP
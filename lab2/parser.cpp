@@ -0,0 +1,352 @@
+#include "parser.hpp"
+
+// std::min
+#include <algorithm>
+// isdigit
+#include <cctype>
+// memcpy
+#include <cstring>
+
+namespace {
+
+bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+// 元字符：可以在不加空格的情况下结束一个单词
+bool IsMeta(char c) {
+  return IsBlank(c) || c == '|' || c == '&' || c == ';' || c == '<' ||
+         c == '>';
+}
+
+enum class Tok { Word, Pipe, Amp, Semi, AndIf, OrIf, Redir, End, Error };
+
+struct Token {
+  Tok kind;
+  std::string_view text; // Tok::Word
+  int fd;                // Tok::Redir
+  RedirType type;        // Tok::Redir
+};
+
+class Lexer {
+public:
+  Lexer(std::string_view line, Arena &arena) : line_(line), arena_(arena) {}
+
+  Token Next() {
+    while (pos_ < line_.size() && IsBlank(line_[pos_])) {
+      ++pos_;
+    }
+    start_ = pos_;
+    // 单词开头的 # 表示注释，直到行尾
+    if (pos_ == line_.size() || line_[pos_] == '#') {
+      pos_ = line_.size();
+      return {Tok::End, {}, -1, RedirType::In};
+    }
+
+    char c = line_[pos_];
+    if (c == '|' || c == '&' || c == ';') {
+      bool doubled = c != ';' && line_.compare(pos_, 2, c == '|' ? "||" : "&&") == 0;
+      pos_ += doubled ? 2 : 1;
+      Tok kind = c == ';'  ? Tok::Semi
+                 : c == '|' ? (doubled ? Tok::OrIf : Tok::Pipe)
+                            : (doubled ? Tok::AndIf : Tok::Amp);
+      return {kind, {}, -1, RedirType::In};
+    }
+
+    // 形如 2> 的数字文件描述符前缀：数字之后紧跟 < 或 >
+    int fd = -1;
+    if (isdigit(static_cast<unsigned char>(c))) {
+      size_t q = pos_;
+      int value = 0;
+      while (q < line_.size() && q - pos_ < 9 &&
+             isdigit(static_cast<unsigned char>(line_[q]))) {
+        value = value * 10 + (line_[q] - '0');
+        ++q;
+      }
+      if (q < line_.size() && (line_[q] == '<' || line_[q] == '>')) {
+        fd = value;
+        pos_ = q;
+        c = line_[pos_];
+      }
+    }
+
+    if (c == '<' || c == '>') {
+      return LexRedirect(fd);
+    }
+
+    Token t{Tok::Word, {}, -1, RedirType::In};
+    if (!ScanWord(t.text)) {
+      t.kind = Tok::Error;
+    }
+    return t;
+  }
+
+  // 最近一个 token 的起始位置和结束位置
+  size_t Start() const { return start_; }
+  size_t Pos() const { return pos_; }
+
+  std::string_view error;
+
+private:
+  Token LexRedirect(int fd) {
+    Token t{Tok::Redir, {}, fd, RedirType::In};
+    if (line_[pos_] == '<') {
+      if (line_.compare(pos_, 3, "<<<") == 0) {
+        t.type = RedirType::HereString;
+        pos_ += 3;
+      } else if (line_.compare(pos_, 2, "<<") == 0) {
+        t.type = RedirType::HereDoc;
+        pos_ += 2;
+      } else {
+        t.type = RedirType::In;
+        pos_ += 1;
+      }
+      if (t.fd < 0) {
+        t.fd = 0;
+      }
+    } else {
+      if (line_.compare(pos_, 2, ">>") == 0) {
+        t.type = RedirType::Append;
+        pos_ += 2;
+      } else {
+        t.type = RedirType::Out;
+        pos_ += 1;
+      }
+      if (t.fd < 0) {
+        t.fd = 1;
+      }
+    }
+    return t;
+  }
+
+  // 读入一个单词。没有引号和转义时直接返回 line 的切片，否则去引号后复制到 arena
+  bool ScanWord(std::string_view &out) {
+    size_t start = pos_;
+    bool plain = true;
+
+    while (pos_ < line_.size() && !IsMeta(line_[pos_])) {
+      char c = line_[pos_];
+      if (c == '\'') {
+        plain = false;
+        size_t close = line_.find('\'', pos_ + 1);
+        if (close == std::string_view::npos) {
+          error = "syntax error: unterminated quote";
+          return false;
+        }
+        pos_ = close + 1;
+      } else if (c == '"') {
+        plain = false;
+        ++pos_;
+        while (pos_ < line_.size() && line_[pos_] != '"') {
+          pos_ += (line_[pos_] == '\\' && pos_ + 1 < line_.size()) ? 2 : 1;
+        }
+        if (pos_ == line_.size()) {
+          error = "syntax error: unterminated quote";
+          return false;
+        }
+        ++pos_;
+      } else if (c == '\\') {
+        plain = false;
+        pos_ += (pos_ + 1 < line_.size()) ? 2 : 1;
+      } else {
+        ++pos_;
+      }
+    }
+
+    std::string_view raw = line_.substr(start, pos_ - start);
+    if (plain) {
+      out = raw;
+      return true;
+    }
+
+    // 去引号后的结果一定不长于原文
+    char *buf = arena_.AllocChars(raw.size());
+    size_t len = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+      char c = raw[i];
+      if (c == '\'') {
+        while (raw[++i] != '\'') {
+          buf[len++] = raw[i];
+        }
+      } else if (c == '"') {
+        while (raw[++i] != '"') {
+          // 双引号内的反斜杠只转义 " \ $ `
+          if (raw[i] == '\\' && raw[i + 1] != '\0' &&
+              strchr("\"\\$`", raw[i + 1]) != nullptr) {
+            ++i;
+          }
+          buf[len++] = raw[i];
+        }
+      } else if (c == '\\' && i + 1 < raw.size()) {
+        buf[len++] = raw[++i];
+      } else {
+        buf[len++] = c;
+      }
+    }
+    out = std::string_view(buf, len);
+    return true;
+  }
+
+  std::string_view line_;
+  size_t pos_ = 0;
+  size_t start_ = 0;
+  Arena &arena_;
+};
+
+// 在 kind 处出现语法错误时的描述
+const char *UnexpectedToken(Tok kind) {
+  switch (kind) {
+  case Tok::Pipe:
+    return "syntax error near unexpected token `|'";
+  case Tok::Amp:
+    return "syntax error near unexpected token `&'";
+  case Tok::Semi:
+    return "syntax error near unexpected token `;'";
+  case Tok::AndIf:
+    return "syntax error near unexpected token `&&'";
+  case Tok::OrIf:
+    return "syntax error near unexpected token `||'";
+  default:
+    return "syntax error";
+  }
+}
+
+} // namespace
+
+bool ParseLine(std::string_view line, Arena &arena, CommandList &out,
+               std::string_view &err) {
+  Lexer lex(line, arena);
+  Pipeline *pl = nullptr; // 当前管道，遇到第一个单词时创建
+  Command *cur = nullptr;
+  Connector next = Connector::Seq; // 下一条管道与前一条的连接方式
+  size_t begin = std::string_view::npos, end = 0;
+  size_t cmdBegin = 0; // 当前命令原文的起始位置
+
+  while (true) {
+    Token t = lex.Next();
+    if (t.kind == Tok::Error) {
+      err = lex.error;
+      return false;
+    }
+
+    if (t.kind == Tok::Word || t.kind == Tok::Redir) {
+      if (pl == nullptr) {
+        pl = &out.pipelines.emplace_back(arena.resource());
+        pl->connector = next;
+        begin = std::string_view::npos;
+      }
+
+      // 管道开头不带引号的 time 是关键字，之后的 -j 是它的选项，都不属于管道原文
+      if (t.kind == Tok::Word && pl->cmds.empty() &&
+          t.text.data() == line.data() + lex.Start()) {
+        if (!pl->timed && t.text == "time") {
+          pl->timed = true;
+          continue;
+        }
+        if (pl->timed && !pl->timeJson && t.text == "-j") {
+          pl->timeJson = true;
+          continue;
+        }
+      }
+
+      begin = std::min(begin, lex.Start());
+      if (cur == nullptr) {
+        cur = &pl->cmds.emplace_back(arena.resource());
+        cmdBegin = lex.Start();
+      }
+    }
+
+    switch (t.kind) {
+    case Tok::Error:
+      break;
+
+    case Tok::Word:
+      cur->args.push_back(t.text);
+      end = lex.Pos();
+      cur->text = line.substr(cmdBegin, end - cmdBegin);
+      break;
+
+    case Tok::Redir: {
+      Token target = lex.Next();
+      if (target.kind != Tok::Word) {
+        err = target.kind == Tok::Error
+                  ? lex.error
+                  : "syntax error: missing redirection target";
+        return false;
+      }
+      cur->redirs.push_back({t.fd, t.type, target.text, {}});
+      end = lex.Pos();
+      cur->text = line.substr(cmdBegin, end - cmdBegin);
+      break;
+    }
+
+    case Tok::Pipe:
+      if (cur == nullptr || cur->args.empty()) {
+        err = UnexpectedToken(t.kind);
+        return false;
+      }
+      cur = nullptr;
+      break;
+
+    case Tok::Amp:
+    case Tok::Semi:
+    case Tok::AndIf:
+    case Tok::OrIf:
+      // 一条管道结束
+      if (cur == nullptr || cur->args.empty()) {
+        err = pl != nullptr && !pl->cmds.empty() && cur == nullptr
+                  ? "syntax error: missing command after `|'"
+                  : UnexpectedToken(t.kind);
+        return false;
+      }
+      pl->background = t.kind == Tok::Amp;
+      pl->text = line.substr(begin, end - begin);
+      next = t.kind == Tok::AndIf  ? Connector::And
+             : t.kind == Tok::OrIf ? Connector::Or
+                                   : Connector::Seq;
+      pl = nullptr;
+      cur = nullptr;
+      break;
+
+    case Tok::End:
+      if (cur != nullptr && cur->args.empty()) {
+        err = "syntax error: missing command";
+        return false;
+      }
+      if (pl != nullptr && cur == nullptr && !pl->cmds.empty()) {
+        err = "syntax error: unexpected end of line after `|'";
+        return false;
+      }
+      if (pl == nullptr && next != Connector::Seq) {
+        err = next == Connector::And
+                  ? "syntax error: unexpected end of line after `&&'"
+                  : "syntax error: unexpected end of line after `||'";
+        return false;
+      }
+      if (pl != nullptr) {
+        if (pl->cmds.empty()) {
+          // 只有 time 关键字，没有命令
+          out.pipelines.pop_back();
+        } else {
+          pl->text = line.substr(begin, end - begin);
+        }
+      }
+      return true;
+    }
+  }
+}
+
+char *ToCString(std::string_view s, Arena &arena) {
+  char *buf = arena.AllocChars(s.size() + 1);
+  memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  return buf;
+}
+
+char **MakeArgv(const Command &cmd, Arena &arena) {
+  char **argv = arena.AllocArray<char *>(cmd.args.size() + 1);
+  for (size_t i = 0; i < cmd.args.size(); i++) {
+    argv[i] = ToCString(cmd.args[i], arena);
+  }
+  // execvp 需要以 nullptr 结尾
+  argv[cmd.args.size()] = nullptr;
+  return argv;
+}
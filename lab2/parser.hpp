@@ -0,0 +1,102 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+// std::max_align_t
+#include <cstddef>
+// std::pmr::monotonic_buffer_resource
+#include <memory_resource>
+// std::string_view
+#include <string_view>
+// std::pmr::vector
+#include <vector>
+
+// 每一行命令对应的内存池。解析产生的 AST 节点以及需要去引号的单词都分配在这里，
+// 下一行开始前调用 Reset() 一次性释放，避免逐个 new/delete。
+class Arena {
+public:
+  Arena() : pool_(buf_, sizeof(buf_)) {}
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  std::pmr::memory_resource *resource() { return &pool_; }
+
+  char *AllocChars(size_t n) {
+    return static_cast<char *>(pool_.allocate(n, alignof(char)));
+  }
+
+  template <typename T> T *AllocArray(size_t n) {
+    return static_cast<T *>(pool_.allocate(n * sizeof(T), alignof(T)));
+  }
+
+  // 释放本行分配的全部内存，回到栈上的初始缓冲区
+  void Reset() { pool_.release(); }
+
+private:
+  alignas(std::max_align_t) char buf_[8192];
+  std::pmr::monotonic_buffer_resource pool_;
+};
+
+enum class RedirType {
+  In,         // <
+  Out,        // >
+  Append,     // >>
+  HereString, // <<<
+  HereDoc,    // <<
+};
+
+struct Redirect {
+  int fd;                  // 被重定向的文件描述符，如 2>file 中的 2
+  RedirType type;
+  std::string_view target; // 文件名 / here-string 文本 / here-doc 结束符
+  std::string_view body;   // here-string/here-doc 的正文，由 ReadHereDocs 填写
+};
+
+// 一条简单命令：参数列表及其重定向
+struct Command {
+  std::pmr::vector<std::string_view> args;
+  std::pmr::vector<Redirect> redirs;
+  std::string_view text; // 原文，用于 time 的分段统计
+
+  explicit Command(std::pmr::memory_resource *mr) : args(mr), redirs(mr) {}
+};
+
+// 管道与前一条管道的连接方式
+enum class Connector {
+  Seq, // 行首，或前一条以 ; 或 & 结束：总是执行
+  And, // &&：前一条成功时才执行
+  Or,  // ||：前一条失败时才执行
+};
+
+// 由 | 连接的若干条命令，末尾可带 & 表示后台执行，开头可带 time [-j] 关键字
+struct Pipeline {
+  std::pmr::vector<Command> cmds;
+  Connector connector = Connector::Seq;
+  bool background = false;
+  bool timed = false;    // time：结束后报告资源使用情况
+  bool timeJson = false; // time -j：以 JSON 格式报告
+  std::string_view text; // 原文（不含末尾的 &），用于 jobs 等显示
+
+  explicit Pipeline(std::pmr::memory_resource *mr) : cmds(mr) {}
+};
+
+// 一行命令：由 ; & && || 分隔的若干条管道，&& 和 || 优先级相同、从左到右结合
+struct CommandList {
+  std::pmr::vector<Pipeline> pipelines;
+
+  explicit CommandList(std::pmr::memory_resource *mr) : pipelines(mr) {}
+};
+
+// 对一行命令做一遍扫描，生成 CommandList。# 开头的单词及其后的内容是注释。
+// 普通单词直接是指向 line 的 string_view；带引号或反斜杠的单词去引号后放在 arena 中，
+// 因此 line 和 arena 必须在使用 out 期间保持有效。
+// 语法错误时返回 false，err 指向静态的错误描述。
+bool ParseLine(std::string_view line, Arena &arena, CommandList &out,
+               std::string_view &err);
+
+// 把 string_view 复制为以 '\0' 结尾的 C 字符串，内存来自 arena
+char *ToCString(std::string_view s, Arena &arena);
+
+// 构造以 nullptr 结尾、每个参数都以 '\0' 结尾的 argv，内存来自 arena
+char **MakeArgv(const Command &cmd, Arena &arena);
+
+#endif // PARSER_HPP
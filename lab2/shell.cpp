@@ -15,179 +15,239 @@
 #include <pwd.h>
 #include <signal.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 
-std::vector<std::string> split(std::string s, const std::string &delimiter);
-
-std::string trim(const std::string &str);
+#include "builtins.hpp"
+#include "cmdhash.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "parallel.hpp"
+#include "parser.hpp"
+#include "spawn.hpp"
+#include "timing.hpp"
 
 void PrintPrompt();
 
-bool IsEmptyCmd(std::string cmdLine);
+bool IsExit(const Pipeline &pipeline);
+
+Job *FindJobArg(const BuiltinArgs &args);
+
+void SaveFd(int fd, std::vector<std::pair<int, int>> &saved);
+
+void RestoreFds(std::vector<std::pair<int, int>> &saved);
 
-bool IsExit(std::string cmdLine);
+bool ApplyRedirects(const Command &cmd, std::vector<std::pair<int, int>> *saved);
 
-int ExitHandler(std::string cmdLine);
+int RunBuiltin(const Command &cmd, BuiltinFn fn, int infd);
 
-bool IsBuiltInCmd(std::string cmdLine);
+pid_t ForkBuiltin(const Command &cmd, BuiltinFn fn, int infd, int outfd,
+                  int closefd, pid_t pgid, bool isBackground);
 
-void BuiltInCmdHandler(std::string cmdLine);
+void ReadHereDocs(CommandList &list, LineSource &in);
 
-bool IsBackgroundCmd(std::string cmdLine);
+bool WriteAll(int fd, std::string_view data);
 
-void RemoveBackgroundSymbol(std::string &cmdLine);
+int OpenHereDoc(std::string_view body);
 
-void SimpleCmdHandler(const std::string &cmdLine);
+int OpenRedirect(const Redirect &redir);
 
-bool IsRedirect(std::string cmdLine);
+bool RedirectCmdHandler(const Command &cmd, SpawnPlan &plan,
+                        std::vector<int> &opened);
 
-void RedirectCmdHandler(std::string cmdLine);
+pid_t SpawnStage(const Command &cmd, int infd, int outfd, pid_t pgid,
+                 bool isBackground);
 
-bool IsPipe(std::string cmdLine);
+int PipeCmdHandler(const Pipeline &pipeline);
 
-void PipeCmdHandler(std::string cmdLine);
+int WaitStatusToCode(int status);
 
 void sigint_handler(int signum);
 
-void process_bgs(std::vector<pid_t> &bg_pids);
+void hide_inout(SpawnPlan &plan);
 
-void hide_inout();
+int ForegroundJob(Job *job, bool cont, PipelineTimer *timer = nullptr);
 
-void wait(std::vector<pid_t> &bg_pids);
+int wait(Job *job);
+
+int RunLines(LineSource &in);
+
+bool RunList(const CommandList &list, int &code);
 
 bool IsProcessing;
 
-std::vector<pid_t> bg_pids; // 用于存储后台进程的pid
+bool interactive = true; // 是否为交互模式（打印提示符、报告后台 job）
+
+bool errexit = false; // set -e：命令失败时退出
+
+bool exiting = false; // 由 exit 或 set -e 引起的退出
+
+const char *script_name = "shell"; // 脚本模式下报错时使用的名字
+
+int last_status = 0; // 上一条前台命令的退出状态
+
+JobTable jobs; // 作业表，后台和被停止的管道都在其中
+
+Arena line_arena; // 当前这一行命令的 AST 所在的内存池
+
+CommandHash cmd_hash; // 命令名到绝对路径的缓存
+
+// 用法：shell [-e] [script | -c cmds]
+// 不带参数时进入交互模式；给出脚本文件或 -c 时以非交互模式执行，不打印提示符。
+// -e 等同于在开头执行 set -e
+int main(int argc, char *argv[]) {
+  const char *script = nullptr;
+  const char *text = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-e") == 0) {
+      errexit = true;
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      text = argv[++i];
+      break;
+    } else if (argv[i][0] == '-') {
+      std::cerr << "usage: " << argv[0] << " [-e] [script | -c cmds]"
+                << std::endl;
+      return 2;
+    } else {
+      script = argv[i]; // 之后的参数被忽略（不支持 $1 等变量）
+      break;
+    }
+  }
+  interactive = script == nullptr && text == nullptr;
 
-int main() {
   // 信号处理
-  struct sigaction shell, child,
-      ign; // shell进程需要忽略SIGINT,子进程需要处理SIGINT
+  struct sigaction shell,
+      ign; // shell进程需要忽略SIGINT,子进程在 fork 后恢复默认处理
 
   shell.sa_flags = 0;
   shell.sa_handler = sigint_handler;
+  sigemptyset(&shell.sa_mask);
   ign.sa_flags = 0;
   ign.sa_handler = SIG_IGN;
+  sigemptyset(&ign.sa_mask);
 
-  sigaction(SIGINT, &shell, &child);
+  // 非交互模式下 Ctrl+C 直接终止脚本
+  if (interactive) {
+    sigaction(SIGINT, &shell, nullptr);
+  }
   sigaction(SIGTTOU, &ign, nullptr);
+  // Ctrl+Z 只停止前台 job，不停止 shell 本身
+  sigaction(SIGTSTP, &ign, nullptr);
+  sigaction(SIGTTIN, &ign, nullptr);
 
-  // 用来存储读入的一行命令
-  std::string cmdLine;
+  // SIGCHLD 驱动的子进程回收
+  jobs.Init();
 
   // 不同步 iostream 和 cstdio 的 buffer
   std::ios::sync_with_stdio(false);
 
-  while (true) {
-    process_bgs(bg_pids); // 处理后台进程
+  if (interactive) {
+    StreamSource in(0);
+    int code = RunLines(in);
+    // 输入结束（如 Ctrl+D）时正常退出，exit 命令则带上它的退出码
+    if (!exiting) {
+      std::cout << "\n";
+      return 0;
+    }
+    return code;
+  }
 
-    IsProcessing = false;
+  ScriptSource in;
+  if (text != nullptr) {
+    in.SetText(text);
+  } else if (!in.Load(script)) {
+    std::cerr << script << ": " << strerror(errno) << std::endl;
+    return 127;
+  }
+  script_name = script != nullptr ? script : argv[0];
+  return RunLines(in);
+}
 
-    // 打印提示符
-    PrintPrompt();
+// 从 in 中逐行读入、解析并执行命令，直到输入结束或 shell 需要退出，返回 shell 的退出码
+int RunLines(LineSource &in) {
+  std::string_view cmdLine;
+  while (true) {
+    // 回收已结束的子进程，报告结束或停止的后台 job
+    jobs.Reap();
+    if (interactive) {
+      jobs.Notify(std::cout);
 
-    // 读入一行。std::getline 结果不包含换行符。
-    std::getline(std::cin, cmdLine);
+      IsProcessing = false;
 
-    // 如果输入为空，继续下一轮循环
-    if (IsEmptyCmd(cmdLine)) {
-      continue;
+      // 打印提示符
+      PrintPrompt();
+    } else {
+      // 脚本中不报告，但仍要删除已结束的后台 job，否则作业表只增不减
+      jobs.Prune();
     }
 
-    // 如果是exit命令，退出
-    if (IsExit(cmdLine)) {
-      return ExitHandler(cmdLine);
+    // 读入一行，不包含换行符
+    if (!in.NextLine(cmdLine)) {
+      return last_status;
     }
 
-    // 如果是exit外的其他内建命令，执行内建命令
-    if (IsBuiltInCmd(cmdLine)) {
-      BuiltInCmdHandler(cmdLine);
-      continue;
-    }
-
-    bool isBackground = IsBackgroundCmd(cmdLine);
-    if (isBackground) {
-      RemoveBackgroundSymbol(cmdLine);
+    // 整行只解析一次，之后的判断和执行都直接读 AST
+    line_arena.Reset();
+    CommandList list(line_arena.resource());
+    std::string_view err;
+    if (!ParseLine(cmdLine, line_arena, list, err)) {
+      if (interactive) {
+        std::cerr << err << std::endl;
+        continue;
+      }
+      // 脚本中的语法错误终止执行，与 sh 一致
+      std::cerr << script_name << ": line " << in.lineno() << ": " << err
+                << std::endl;
+      return 2;
     }
 
-    // 处理外部命令
-    pid_t pid = fork();
+    // here-doc 的正文紧跟在命令行之后，执行前先全部读入
+    ReadHereDocs(list, in);
 
-    IsProcessing = true;
-
-    if (pid == 0) {
-      // 子进程不能忽略SIG_IGN，故需要恢复默认行为
-      sigaction(SIGINT, &child, nullptr);
-      // signal(SIGTTOU,SIG_DFL);
-      if (isBackground) {
-        hide_inout();
-      }
-      // 子进程0，用于执行外部命令
-      if (IsPipe(cmdLine)) {
-        PipeCmdHandler(cmdLine);
-        exit(0);
-      } else if (IsRedirect(cmdLine)) {
-        RedirectCmdHandler(cmdLine);
-        exit(0);
-      } else {
-        // 不包含管道和重定向符号的简单外部命令
-        SimpleCmdHandler(cmdLine);
-      }
-    } else {
-      // 这里只有父进程（原进程）才会进入
-      if (isBackground) {
-        bg_pids.push_back(pid);
-        continue;
-      }
-      setpgid(pid, pid); // 将进程组id设置为子进程id
-      tcsetpgrp(0, pid); // 将前台进程组设置为子进程的进程组
-      sigaction(SIGTTOU, &ign, nullptr);
-      int status; // 表示子进程是否结束
-      // 等待子进程pid结束
-      int ret = waitpid(
-          pid, &status,
-          0); // 这里需要修改为waitpid，以知道子程序是正常结束还是因为接收到信号而结束
-      tcsetpgrp(0, getpgrp()); // 将前台进程组设置为shell进程的进程组
-      // int ret = wait(&over);
-      if (ret < 0) {
-        std::cout << "wait failed";
-      } else if (WIFSIGNALED(status)) {
-        // 子程序因接收到信号而结束时，需要输出换行符（正常结束时不需要做任何处理）
-        std::cout << std::endl;
-      }
+    int code;
+    if (!RunList(list, code)) {
+      exiting = true;
+      return code;
     }
   }
-  return 0;
 }
 
-std::string trim(const std::string &str) {
-  size_t first = str.find_first_not_of(' ');
-  if (std::string::npos == first) {
-    return str;
-  }
-  size_t last = str.find_last_not_of(' ');
-  return str.substr(first, (last - first + 1));
-}
+// 按 ; & && || 的规则依次执行一行中的各条管道。
+// 遇到 exit、set -e 下的失败或者脚本中的命令被 Ctrl+C 终止时返回 false，code 为 shell 的退出码
+bool RunList(const CommandList &list, int &code) {
+  const auto &pipelines = list.pipelines;
+  for (size_t i = 0; i < pipelines.size(); i++) {
+    const Pipeline &pipeline = pipelines[i];
+    // && 和 || 根据到目前为止最后一条执行的管道的状态决定是否跳过
+    if ((pipeline.connector == Connector::And && last_status != 0) ||
+        (pipeline.connector == Connector::Or && last_status == 0)) {
+      continue;
+    }
 
-// 经典的 cpp string split 实现
-// https://stackoverflow.com/a/14266139/11691878
-std::vector<std::string> split(std::string s, const std::string &delimiter) {
-  std::vector<std::string> res;
-  size_t pos = 0;
-  std::string token;
+    // 如果是exit命令，退出
+    if (IsExit(pipeline)) {
+      code = BuiltinExit(pipeline.cmds[0].args);
+      return false;
+    }
 
-  s = trim(s); // trim the string
+    // 执行命令：管道的每一段都由 shell 直接创建，单条命令看作只有一段的管道，
+    // 内建命令尽量在 shell 进程中执行
+    IsProcessing = true;
+    last_status = PipeCmdHandler(pipeline);
 
-  while ((pos = s.find(delimiter)) != std::string::npos) {
-    token = s.substr(0, pos);
-    token = trim(token); // trim the token
-    if (!token.empty())
-      res.push_back(token);
-    s = s.substr(pos + delimiter.length());
+    if (!interactive && last_status == 128 + SIGINT) {
+      code = last_status;
+      return false;
+    }
+    // set -e：只有 && / || 链中最后一条管道失败时才退出，与 sh 一致
+    bool chainEnd = i + 1 == pipelines.size() ||
+                    pipelines[i + 1].connector == Connector::Seq;
+    if (errexit && last_status != 0 && chainEnd && !pipeline.background) {
+      code = last_status;
+      return false;
+    }
   }
-  s = trim(s); // trim the last part
-  res.push_back(s);
-  return res;
+  return true;
 }
 
 void PrintPrompt() {
@@ -217,23 +277,25 @@ void PrintPrompt() {
   // 打印提示符
   std::cout << "[MyShell]" << username << "@" << hostname << ":" << path
             << prompt << " ";
+  // 读命令直接 read(0)，不再经过与 std::cout 绑定的 std::cin，需要手动刷新
+  std::cout.flush();
 }
 
-bool IsEmptyCmd(std::string cmdLine) { return cmdLine.empty(); }
 
-bool IsExit(std::string cmdLine) {
-  std::vector<std::string> args = split(cmdLine, " ");
-  return args[0] == "exit";
+// 只有单独一条前台的 exit 才会退出 shell；管道中的 exit 只结束它所在的那一段
+bool IsExit(const Pipeline &pipeline) {
+  return pipeline.cmds.size() == 1 && !pipeline.background &&
+         pipeline.cmds[0].args[0] == "exit";
 }
 
-int ExitHandler(std::string cmdLine) {
-  std::vector<std::string> args = split(cmdLine, " ");
+// exit [n]：不带参数时以上一条命令的退出状态退出
+int BuiltinExit(const BuiltinArgs &args) {
   if (args.size() <= 1) {
-    return 0;
+    return last_status;
   }
 
   // std::string 转 int
-  std::stringstream code_stream(args[1]);
+  std::stringstream code_stream{std::string(args[1])};
   int code = 0;
   code_stream >> code;
 
@@ -246,247 +308,611 @@ int ExitHandler(std::string cmdLine) {
   return code;
 }
 
-bool IsBuiltInCmd(std::string cmdLine) {
-  std::vector<std::string> args = split(cmdLine, " ");
-  return args[0] == "pwd" || args[0] == "cd" || args[0] == "wait";
-}
-
-void BuiltInCmdHandler(std::string cmdLine) {
-  std::vector<std::string> args = split(cmdLine, " ");
-
-  if (args[0] == "pwd") {
-    char cwd[PATH_MAX];
-    if (getcwd(cwd, PATH_MAX) != NULL) {
-      std::cout << cwd << "\n";
+int BuiltinCd(const BuiltinArgs &args) {
+  if (args.size() < 2) {
+    char *home = getenv("HOME");
+    if (home) {
+      if (chdir(home) != 0) {
+        std::cout << "cd: " << strerror(errno) << "\n";
+        return 1;
+      }
     } else {
-      std::cout << "Error getting current directory\n";
+      std::cout << "cd: HOME environment variable not set\n";
+      return 1;
+    }
+  } else {
+    if (chdir(ToCString(args[1], line_arena)) != 0) {
+      std::cout << "cd: " << strerror(errno) << "\n";
+      return 1;
     }
-    return;
   }
+  return 0;
+}
 
-  if (args[0] == "cd") {
-    if (args.size() < 2) {
-      char *home = getenv("HOME");
-      if (home) {
-        if (chdir(home) != 0) {
-          std::cout << "cd: " << strerror(errno) << "\n";
-        }
-      } else {
-        std::cout << "cd: HOME environment variable not set\n";
-      }
-    } else {
-      if (chdir(args[1].c_str()) != 0) {
-        std::cout << "cd: " << strerror(errno) << "\n";
+// wait：等待所有运行中的后台 job；wait %n 或 wait pid 只等待指定的 job
+int BuiltinWait(const BuiltinArgs &args) {
+  if (args.size() == 1) {
+    std::vector<Job *> running;
+    for (const auto &entry : jobs.jobs()) {
+      if (entry.second->State() == JobState::Running) {
+        running.push_back(entry.second.get());
       }
     }
-    return;
+    for (Job *job : running) {
+      wait(job);
+    }
+    return 0;
   }
 
-  if (args[0] == "wait") {
-    if (args.size() > 1) {
-      std::cout << "Too many arguments!\n";
-      return;
+  int status = 0;
+  for (size_t i = 1; i < args.size(); i++) {
+    Job *job = jobs.Find(args[i]);
+    if (job == nullptr) {
+      std::cout << "wait: " << args[i] << ": no such job\n";
+      status = 127;
+      continue;
     }
-    wait(bg_pids);
-    return;
+    status = wait(job);
   }
-
-  return;
+  return status;
 }
 
-bool IsBackgroundCmd(std::string cmdLine) {
-  std::vector<std::string> args = split(cmdLine, " ");
-  return args[args.size() - 1] == "&";
+int BuiltinJobs(const BuiltinArgs &) {
+  for (const auto &entry : jobs.jobs()) {
+    jobs.Print(std::cout, entry.second.get());
+  }
+  return 0;
 }
 
-void RemoveBackgroundSymbol(std::string &cmdLine) {
-  cmdLine = cmdLine.substr(0, cmdLine.find_last_of("&"));
+// fg/bg 不带参数时作用于当前 job（%+）
+Job *FindJobArg(const BuiltinArgs &args) {
+  std::string_view spec = args.size() > 1 ? args[1] : std::string_view();
+  Job *job = jobs.Find(spec);
+  if (job == nullptr) {
+    std::cout << args[0] << ": " << (spec.empty() ? "current" : spec)
+              << ": no such job\n";
+  }
+  return job;
 }
 
-// 需要在一个独立的子进程中被调用，因为使用了execvp
-void SimpleCmdHandler(const std::string &cmdLine) {
-  // 分割命令行参数
-  std::vector<std::string> args = split(cmdLine, " ");
-  // 将 std::string 转换为 char*
-  char **argv = new char *[args.size() + 1];
-  for (size_t i = 0; i < args.size(); i++) {
-    argv[i] = new char[args[i].size() + 1];
-    strcpy(argv[i], args[i].c_str());
+int BuiltinFg(const BuiltinArgs &args) {
+  Job *job = FindJobArg(args);
+  if (job == nullptr) {
+    return 1;
   }
-  // execvp 需要以 nullptr 结尾
-  argv[args.size()] = nullptr;
-  // 执行外部命令
-  execvp(argv[0], argv);
-  // 如果 execvp 返回，说明出错
-  std::cout << "Command not found\n";
-  exit(1);
+  std::cout << job->cmdline << std::endl;
+  return ForegroundJob(job, true);
 }
 
-bool IsRedirect(std::string cmdLine) {
-  return cmdLine.find(">") != std::string::npos ||
-         cmdLine.find("<") != std::string::npos;
+int BuiltinBg(const BuiltinArgs &args) {
+  Job *job = FindJobArg(args);
+  if (job == nullptr) {
+    return 1;
+  }
+  if (job->State() == JobState::Stopped) {
+    jobs.Continue(job);
+    std::cout << "[" << job->id << "]+ " << job->cmdline << " &\n";
+  }
+  return 0;
 }
 
-void RedirectCmdHandler(std::string cmdLine) {
-  std::vector<std::string> parts = split(cmdLine, " ");
-  if (parts.size() < 3) {
-    std::cerr << "error: cmdLine does not contain enough parts" << std::endl;
-    return;
+// hash：列出缓存；hash -r 清空；hash -d name 删除；hash name... 预先解析
+int BuiltinHash(const BuiltinArgs &args) {
+  int status = 0;
+  if (args.size() == 1) {
+    cmd_hash.Print(std::cout);
+  } else if (args[1] == "-r") {
+    cmd_hash.Clear();
+  } else if (args[1] == "-d") {
+    for (size_t i = 2; i < args.size(); i++) {
+      cmd_hash.Forget(args[i]);
+    }
+  } else {
+    for (size_t i = 1; i < args.size(); i++) {
+      if (!cmd_hash.Add(args[i])) {
+        std::cout << "hash: " << args[i] << ": not found\n";
+        status = 1;
+      }
+    }
   }
+  return status;
+}
 
-  std::string command;
-  std::string redirectionSymbol;
-  std::string filename;
-  int redirectionPos = -1;
+// set -e / set +e：打开或关闭“命令失败时退出”
+int BuiltinSet(const BuiltinArgs &args) {
+  for (size_t i = 1; i < args.size(); i++) {
+    if (args[i] == "-e") {
+      errexit = true;
+    } else if (args[i] == "+e") {
+      errexit = false;
+    } else {
+      std::cerr << "set: " << args[i] << ": invalid option" << std::endl;
+      return 2;
+    }
+  }
+  return 0;
+}
 
-  // Find the redirection symbol and its position
-  for (size_t i = 0; i < parts.size(); ++i) {
-    if (parts[i].find(">") != std::string::npos ||
-        parts[i].find("<") != std::string::npos) {
-      redirectionSymbol = parts[i];
-      filename = parts[i + 1];
-      redirectionPos = i;
+// parallel [-j N] [-a file] [-0] [-u] command [arg...]：
+// 对标准输入（或 -a 指定的文件）中的每一行执行一次 command，最多同时运行 N 个（默认为 CPU 数）。
+// 参数中的 {} 替换为该行，没有 {} 时该行作为最后一个参数。
+// 默认每个任务的输出按输入顺序整块输出，-u 时直接输出；-0 表示输入项以 NUL 分隔。
+// 退出状态为失败的任务数，最大 101
+int BuiltinParallel(const BuiltinArgs &args) {
+  long maxJobs = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *file = nullptr;
+  char delim = '\n';
+  bool group = true;
+
+  size_t i = 1;
+  for (; i < args.size() && args[i].size() > 1 && args[i][0] == '-'; i++) {
+    if (args[i] == "--") {
+      i++;
       break;
+    } else if (args[i] == "-0") {
+      delim = '\0';
+    } else if (args[i] == "-u") {
+      group = false;
+    } else if (args[i] == "-a" && i + 1 < args.size()) {
+      file = ToCString(args[++i], line_arena);
+    } else if (args[i].substr(0, 2) == "-j" &&
+               (args[i].size() > 2 || i + 1 < args.size())) {
+      // -j N 和 -jN 两种写法
+      std::string n(args[i].size() > 2 ? args[i].substr(2) : args[++i]);
+      char *end;
+      maxJobs = strtol(n.c_str(), &end, 10);
+      if (n.empty() || *end != '\0' || maxJobs <= 0) {
+        std::cerr << "parallel: " << n << ": invalid job count" << std::endl;
+        return 2;
+      }
+    } else {
+      std::cerr << "parallel: " << args[i] << ": invalid option" << std::endl;
+      return 2;
     }
   }
+  if (i >= args.size()) {
+    std::cerr << "usage: parallel [-j N] [-a file] [-0] [-u] command [arg...]"
+              << std::endl;
+    return 2;
+  }
 
-  // If no redirection symbol is found, return an error
-  if (redirectionPos == -1) {
-    std::cerr << "error: no redirection symbol found" << std::endl;
-    return;
+  int infd = 0;
+  if (file != nullptr && (infd = open(file, O_RDONLY | O_CLOEXEC)) < 0) {
+    std::cerr << "parallel: " << file << ": " << strerror(errno) << std::endl;
+    return 2;
   }
 
-  // Construct the command with all parts before the redirection symbol
-  for (int i = 0; i < redirectionPos; ++i) {
-    command += parts[i] + " ";
+  std::vector<std::string> tmpl(args.begin() + i, args.end());
+  ParallelRunner runner(cmd_hash, std::move(tmpl), maxJobs, group);
+  size_t failed = runner.Run(infd, delim);
+  if (infd != 0) {
+    close(infd);
   }
+  if (failed > 0) {
+    std::cerr << "parallel: " << failed << " of " << runner.started()
+              << " jobs failed" << std::endl;
+  }
+  return failed > 101 ? 101 : static_cast<int>(failed);
+}
 
-  int fd;
-  int oldfd;
-  int fdRedirected;
-  int customFd = -1;
+// 保存 fd 的当前值，供 RestoreFds 恢复。fd 原本未打开时记为 -1，恢复时关闭
+void SaveFd(int fd, std::vector<std::pair<int, int>> &saved) {
+  saved.emplace_back(fd, fcntl(fd, F_DUPFD_CLOEXEC, 10));
+}
 
-  if (redirectionSymbol.find(">") != std::string::npos) {
-    fdRedirected = 1;
-  } else {
-    fdRedirected = 0;
-  }
-
-  // Check if the redirection symbol starts with a number (file descriptor)
-  if (isdigit(redirectionSymbol[0])) {
-    customFd = std::stoi(redirectionSymbol.substr(
-        0, redirectionSymbol.find_first_not_of("0123456789")));
-    redirectionSymbol = redirectionSymbol.back();
-  }
-
-  fdRedirected = customFd != -1 ? customFd : fdRedirected;
-
-  if (redirectionSymbol == ">") {
-    fd = open(filename.c_str(), O_WRONLY | O_TRUNC | O_CREAT, 0666);
-    oldfd = dup(fdRedirected);
-    dup2(fd, fdRedirected);
-  } else if (redirectionSymbol == ">>") {
-    fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
-    oldfd = dup(fdRedirected);
-    dup2(fd, fdRedirected);
-  } else if (redirectionSymbol == "<") {
-    fd = open(filename.c_str(), O_RDONLY);
-    oldfd = dup(fdRedirected);
-    dup2(fd, fdRedirected);
-  } else if (redirectionSymbol == "<<<") {
-    fd = open("/tmp/tempfile", O_WRONLY | O_TRUNC | O_CREAT, 0666);
-    std::string input = filename + "\n";
-    write(fd, input.c_str(), input.size());
-    close(fd);
-    fd = open("/tmp/tempfile", O_RDONLY);
-    oldfd = dup(0);
-    dup2(fd, 0);
-  } else if (redirectionSymbol == "<<") {
-    // Handle EOF redirection
-    // This is a simplified version and does not handle all cases
-    fd = open("/tmp/tempfile", O_WRONLY | O_TRUNC | O_CREAT, 0666);
-    std::string line;
-    while (std::getline(std::cin, line) && line != "EOF") {
-      line += '\n';
-      write(fd, line.c_str(), line.size());
+void RestoreFds(std::vector<std::pair<int, int>> &saved) {
+  for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+    if (it->second != -1) {
+      dup2(it->second, it->first);
+      close(it->second);
+    } else {
+      close(it->first);
+    }
+  }
+  saved.clear();
+}
+
+// 在当前进程中按顺序应用重定向。saved 不为空时先记录被覆盖的 fd
+bool ApplyRedirects(const Command &cmd, std::vector<std::pair<int, int>> *saved) {
+  for (const Redirect &redir : cmd.redirs) {
+    int fd = OpenRedirect(redir);
+    if (fd < 0) {
+      std::cerr << redir.target << ": " << strerror(errno) << std::endl;
+      return false;
     }
+    if (saved != nullptr) {
+      SaveFd(redir.fd, *saved);
+    }
+    dup2(fd, redir.fd);
     close(fd);
-    fd = open("/tmp/tempfile", O_RDONLY);
-    oldfd = dup(0);
-    dup2(fd, 0);
-  } else {
-    std::cerr << "error: unknown redirection symbol" << std::endl;
-    return;
   }
+  return true;
+}
+
+// 在 shell 进程中执行内建命令，infd 不为 -1 时作为标准输入。
+// 执行前后刷新 std::cout，保证输出进入重定向的目标，执行完后恢复 shell 自己的 fd
+int RunBuiltin(const Command &cmd, BuiltinFn fn, int infd) {
+  std::cout.flush();
+  std::vector<std::pair<int, int>> saved;
+  if (infd != -1) {
+    SaveFd(0, saved);
+    dup2(infd, 0);
+  }
+  int status = ApplyRedirects(cmd, &saved) ? fn(cmd.args) : 1;
+  std::cout.flush();
+  std::cerr.flush();
+  RestoreFds(saved);
+  return status;
+}
+
+// 内建命令不是管道的最后一段或者在后台运行时，必须 fork 出子进程来执行，
+// 这是唯一还需要 fork 的地方。子进程不会 exec，O_CLOEXEC 不起作用，
+// 因此本段管道的读端 closefd 要手动关闭。其余参数含义同 SpawnStage
+pid_t ForkBuiltin(const Command &cmd, BuiltinFn fn, int infd, int outfd,
+                  int closefd, pid_t pgid, bool isBackground) {
+  // 避免子进程把 shell 缓冲区中尚未输出的内容再输出一遍
+  std::cout.flush();
+  std::cerr.flush();
 
   pid_t pid = fork();
-  if (pid == 0) {
-    // Child process
-    SimpleCmdHandler(command);
-  } else if (pid > 0) {
-    // Parent process
-    waitpid(pid, nullptr, 0);
-    dup2(oldfd, fdRedirected);
-    close(fd);
-    close(oldfd);
-  } else {
-    // Fork failed
-    std::cerr << "error: fork failed" << std::endl;
-    return;
+  if (pid != 0) {
+    if (pid < 0) {
+      std::cerr << "error: fork failed" << std::endl;
+    }
+    return pid;
+  }
+
+  // Child process
+  setpgid(0, pgid);
+  if (isBackground) {
+    int null_fd = open("/dev/null", O_RDWR);
+    dup2(null_fd, 0);
+    dup2(null_fd, 1);
+    dup2(null_fd, 2);
+    close(null_fd);
+  } else if (pgid == 0 && isatty(0)) {
+    tcsetpgrp(0, getpgrp());
+  }
+  // 子进程不能沿用 shell 的信号处理，需要恢复默认行为
+  for (int sig : {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD, SIGPIPE}) {
+    signal(sig, SIG_DFL);
+  }
+  if (infd != -1) {
+    dup2(infd, 0);
+    close(infd);
+  }
+  if (outfd != -1) {
+    dup2(outfd, 1);
+    close(outfd);
+  }
+  if (closefd != -1) {
+    close(closefd);
   }
+  int status = ApplyRedirects(cmd, nullptr) ? fn(cmd.args) : 1;
+  std::cout.flush();
+  std::cerr.flush();
+  _exit(status);
 }
 
-bool IsPipe(std::string cmdLine) {
-  return cmdLine.find("|") != std::string::npos;
+// 为 here-string 和 here-doc 准备正文。here-doc 的正文是命令行之后直到结束符的各行，
+// 结束符可以是任意单词。正文放在本行的 arena 中。
+void ReadHereDocs(CommandList &list, LineSource &in) {
+  for (Pipeline &pipeline : list.pipelines) {
+    for (Command &cmd : pipeline.cmds) {
+      for (Redirect &redir : cmd.redirs) {
+        if (redir.type == RedirType::HereString) {
+          char *buf = line_arena.AllocChars(redir.target.size() + 1);
+          memcpy(buf, redir.target.data(), redir.target.size());
+          buf[redir.target.size()] = '\n';
+          redir.body = std::string_view(buf, redir.target.size() + 1);
+        } else if (redir.type == RedirType::HereDoc) {
+          if (!in.ReadHereDoc(redir.target, line_arena, redir.body)) {
+            std::cerr << "warning: here-document delimited by end-of-file "
+                         "(wanted `"
+                      << redir.target << "')" << std::endl;
+          }
+        }
+      }
+    }
+  }
 }
 
-void PipeCmdHandler(std::string cmdLine) {
-  std::vector<std::string> cmds = split(cmdLine, "|");
-  if (cmds.size() < 2) {
-    std::cerr << "error: cmdLine does not contain enough parts" << std::endl;
-    return;
+// 把 data 全部写入 fd，成功返回 true
+bool WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(n);
   }
+  return true;
+}
 
+// 返回一个读出 body 内容的 fd（带 O_CLOEXEC），不经过文件系统，多个 shell 之间也不会冲突。
+// 正文能放进管道缓冲区时直接写入管道（写端随即关闭，读端读完即 EOF）；
+// 否则放进 memfd_create 创建的匿名内存文件。
+int OpenHereDoc(std::string_view body) {
   int pipefd[2];
-  int oldfd = 0;
+  if (body.size() <= 65536 && pipe2(pipefd, O_CLOEXEC) == 0) {
+    // 管道容量可能被 /proc/sys/fs/pipe-user-pages-soft 调小，超过 PIPE_BUF 时先确认
+    if (body.size() <= PIPE_BUF ||
+        fcntl(pipefd[1], F_GETPIPE_SZ) >= static_cast<int>(body.size())) {
+      bool ok = WriteAll(pipefd[1], body);
+      close(pipefd[1]);
+      if (ok) {
+        return pipefd[0];
+      }
+      close(pipefd[0]);
+      return -1;
+    }
+    close(pipefd[0]);
+    close(pipefd[1]);
+  }
+
+  int fd = memfd_create("heredoc", MFD_CLOEXEC);
+  if (fd < 0) {
+    // 内核不支持 memfd 时退回到不可见的匿名临时文件
+    fd = open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+      return -1;
+    }
+  }
+  if (!WriteAll(fd, body) || lseek(fd, 0, SEEK_SET) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// 在 shell 进程中打开重定向用到的文件，返回带 O_CLOEXEC 的 fd，失败返回 -1。
+int OpenRedirect(const Redirect &redir) {
+  const char *filename = ToCString(redir.target, line_arena);
+
+  switch (redir.type) {
+  case RedirType::Out:
+    return open(filename, O_WRONLY | O_TRUNC | O_CREAT | O_CLOEXEC, 0666);
+  case RedirType::Append:
+    return open(filename, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+  case RedirType::In:
+    return open(filename, O_RDONLY | O_CLOEXEC);
+  case RedirType::HereString:
+  case RedirType::HereDoc:
+    return OpenHereDoc(redir.body);
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+// 把一条命令的重定向按从左到右的顺序加入 plan。
+// 打开的 fd 记录在 opened 中，由调用者在 spawn 之后关闭。
+bool RedirectCmdHandler(const Command &cmd, SpawnPlan &plan,
+                        std::vector<int> &opened) {
+  for (const Redirect &redir : cmd.redirs) {
+    int fd = OpenRedirect(redir);
+    if (fd < 0) {
+      std::cerr << redir.target << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+    opened.push_back(fd);
+    plan.Dup2(fd, redir.fd);
+  }
+  return true;
+}
+
+// 用 posix_spawn 创建管道中的一段，infd/outfd 为 -1 时沿用 shell 的标准输入/输出。
+// pgid 为 0 时新建进程组。失败返回 -1。
+pid_t SpawnStage(const Command &cmd, int infd, int outfd, pid_t pgid,
+                 bool isBackground) {
+  SpawnPlan plan;
+  plan.SetProcessGroup(pgid);
+  if (isBackground) {
+    hide_inout(plan);
+  } else if (pgid == 0 && isatty(0)) {
+    // 第一段在 exec 之前就把自己设为前台进程组，避免读终端时收到 SIGTTIN
+    plan.SetForeground(0);
+  }
+  if (infd != -1) {
+    plan.Dup2(infd, 0);
+  }
+  if (outfd != -1) {
+    plan.Dup2(outfd, 1);
+  }
+
+  std::vector<int> opened;
+  pid_t pid = -1;
+  if (RedirectCmdHandler(cmd, plan, opened)) {
+    char **argv = MakeArgv(cmd, line_arena);
+    const char *path = cmd_hash.Lookup(argv[0]);
+    if (path != nullptr) {
+      pid = plan.Spawn(path, argv);
+      if (pid < 0 && errno == ENOENT && path != argv[0]) {
+        // 缓存的文件已被删除或移动：删除该项，重新搜索 PATH 后再试一次
+        cmd_hash.Forget(argv[0]);
+        path = cmd_hash.Lookup(argv[0]);
+        pid = path != nullptr ? plan.Spawn(path, argv) : -1;
+      }
+    }
+    if (path == nullptr) {
+      errno = ENOENT;
+    }
+    if (pid < 0) {
+      if (errno == ENOENT) {
+        std::cerr << "Command not found\n";
+      } else {
+        std::cerr << argv[0] << ": " << strerror(errno) << std::endl;
+      }
+    }
+  }
+  for (int fd : opened) {
+    close(fd);
+  }
+  return pid;
+}
+
+// 所有阶段先全部创建并放入同一个进程组，再统一回收，各阶段可以真正并发执行。
+// 外部命令通过 posix_spawn 创建；内建命令作为前台管道的最后一段（或单独一条命令）时
+// 直接在 shell 中执行，其余情况 fork 出子进程执行。
+// 返回最后一段的退出状态；后台管道立即返回 0。
+// 带 time 关键字的前台管道结束后向标准错误输出各段的资源使用情况
+int PipeCmdHandler(const Pipeline &pipeline) {
+  const auto &cmds = pipeline.cmds;
+  bool isBackground = pipeline.background;
+
+  PipelineTimer timer;
+  PipelineTimer *timed = pipeline.timed && !isBackground ? &timer : nullptr;
+  if (timed != nullptr) {
+    timed->Start();
+  }
+
+  // 单独一条前台内建命令：不创建任何进程
+  if (cmds.size() == 1 && !isBackground) {
+    if (BuiltinFn fn = FindBuiltin(cmds[0].args[0])) {
+      if (timed == nullptr) {
+        return RunBuiltin(cmds[0], fn, -1);
+      }
+      timed->BeginBuiltin();
+      int code = RunBuiltin(cmds[0], fn, -1);
+      timed->EndBuiltin(0, cmds[0].text, code);
+      timed->Report(std::cerr, pipeline.text, code, pipeline.timeJson);
+      return code;
+    }
+  }
+
+  std::vector<pid_t> pids;
+  pids.reserve(cmds.size());
+  pid_t pgid = 0;
+  int prevfd = -1; // 上一段管道的读端，作为本段的标准输入
+  bool lastFailed = false;
+  BuiltinFn lastBuiltin = nullptr; // 留给 shell 自己执行的最后一段
 
   for (size_t i = 0; i < cmds.size(); ++i) {
-    if (pipe(pipefd) == -1) {
+    bool isLast = i == cmds.size() - 1;
+    BuiltinFn fn = FindBuiltin(cmds[i].args[0]);
+    if (fn != nullptr && isLast && !isBackground) {
+      // 最后一段等其余各段都创建之后再执行，prevfd 留给它作为标准输入
+      lastBuiltin = fn;
+      break;
+    }
+
+    int pipefd[2] = {-1, -1};
+    // O_CLOEXEC：不属于本段的管道端在 exec 时自动关闭，避免读端永远等不到 EOF
+    if (!isLast && pipe2(pipefd, O_CLOEXEC) == -1) {
       std::cerr << "error: pipe failed" << std::endl;
-      return;
+      break;
     }
 
-    pid_t pid = fork();
-    if (pid == 0) {
-      // Child process
-      dup2(oldfd, 0);
-      if (i < cmds.size() - 1) {
-        dup2(pipefd[1], 1);
+    // 某一段创建失败时其余各段照常运行，与 bash 一致
+    pid_t pid = fn != nullptr ? ForkBuiltin(cmds[i], fn, prevfd, pipefd[1],
+                                            pipefd[0], pgid, isBackground)
+                              : SpawnStage(cmds[i], prevfd, pipefd[1], pgid,
+                                           isBackground);
+    if (pid > 0) {
+      if (pgid == 0) {
+        pgid = pid; // 第一段的 pid 作为整个管道的进程组 id
+        if (fn != nullptr) {
+          setpgid(pid, pgid); // fork 出的子进程与父进程各设置一次，避免竞争
+        }
       }
-      close(pipefd[0]);
-      if (IsRedirect(cmds[i])) {
-        RedirectCmdHandler(cmds[i]);
-        // 子进程执行完毕后，直接退出
-        exit(0);
-      } else {
-        SimpleCmdHandler(cmds[i]);
+      pids.push_back(pid);
+      if (timed != nullptr) {
+        timed->Spawned(i, pid, cmds[i].text);
       }
-    } else if (pid > 0) {
-      // Parent process
-      waitpid(-1, nullptr, 0);
+    } else if (isLast) {
+      lastFailed = true;
+    }
+
+    // 父进程及时关闭已交给子进程的管道端
+    if (prevfd != -1) {
+      close(prevfd);
+    }
+    if (!isLast) {
       close(pipefd[1]);
-      oldfd = pipefd[0];
-    } else {
-      // Fork failed
-      std::cerr << "error: fork failed" << std::endl;
-      return;
+    }
+    prevfd = pipefd[0];
+  }
+
+  Job *job = pids.empty() ? nullptr
+                          : jobs.Add(pgid, pids, pipeline.text, isBackground);
+  if (isBackground) {
+    if (prevfd != -1) {
+      close(prevfd);
+    }
+    if (job != nullptr && interactive) {
+      std::cerr << "[" << job->id << "] " << pgid << std::endl;
+    }
+    return job != nullptr ? 0 : 1;
+  }
+
+  int code = lastFailed ? 127 : 1;
+  if (lastBuiltin != nullptr) {
+    if (timed != nullptr) {
+      timed->BeginBuiltin();
+    }
+    code = RunBuiltin(cmds.back(), lastBuiltin, prevfd);
+    if (timed != nullptr) {
+      timed->EndBuiltin(cmds.size() - 1, cmds.back().text, code);
     }
   }
+  if (prevfd != -1) {
+    close(prevfd);
+  }
+  if (job != nullptr) {
+    int jobCode = ForegroundJob(job, false, timed);
+    if (lastBuiltin == nullptr && !lastFailed) {
+      code = jobCode;
+    }
+  }
+  if (timed != nullptr) {
+    timed->Report(std::cerr, pipeline.text, code, pipeline.timeJson);
+  }
+  return code;
+}
+
+// 在前台运行 job 直到结束或被停止，返回退出码。结束的 job 从作业表中删除，
+// timer 不为空时在删除前取出各进程的资源使用情况
+int ForegroundJob(Job *job, bool cont, PipelineTimer *timer) {
+  jobs.WaitForeground(job, cont);
+
+  if (job->State() == JobState::Stopped) {
+    std::cout << "\n";
+    jobs.Print(std::cout, job);
+    return 128 + SIGTSTP;
+  }
+
+  bool signaled = false;
+  for (const Process &p : job->procs) {
+    // 上游因下游退出而收到 SIGPIPE 是正常现象，不算被中断
+    signaled = signaled ||
+               (WIFSIGNALED(p.status) && WTERMSIG(p.status) != SIGPIPE);
+  }
+  if (signaled) {
+    // 子程序因接收到信号而结束时，需要输出换行符（正常结束时不需要做任何处理）
+    std::cout << std::endl;
+  }
+  int code = WaitStatusToCode(job->LastStatus());
+  if (timer != nullptr) {
+    timer->Collect(*job);
+  }
+  jobs.Remove(job);
+  return code;
+}
+
+// 把 waitpid 得到的状态转换为 shell 的退出码：正常退出取退出码，被信号终止为 128+信号
+int WaitStatusToCode(int status) {
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return 1;
 }
 
 void sigint_handler(int signum) {
-  // 清空输入流中的残留数据并重置输入流状态
-  std::cin.ignore(std::cin.rdbuf()->in_avail());
   // 开始下一行
   std::cout << "\n";
   if (!IsProcessing) {
@@ -496,38 +922,26 @@ void sigint_handler(int signum) {
   std::cout.flush();
 }
 
-// 处理后台进程，删除bg_pids中已经结束的命令，防止出现僵尸进程
-void process_bgs(std::vector<pid_t> &bg_pids) {
-  for (int i = bg_pids.size() - 1; i >= 0; i--) {
-    int status;
-    if (waitpid(bg_pids[i], &status, WNOHANG) > 0) {
-      bg_pids.erase(bg_pids.begin() + i);
-    }
-  }
-}
-
-void hide_inout() {
-  int null_fd = open("/dev/null", O_RDWR);
-  if (null_fd < 0) {
-    std::cout << "open /dev/null failed\n";
-    return;
-  }
-  dup2(null_fd, 0);
-  dup2(null_fd, 1);
-  dup2(null_fd, 2);
-  close(null_fd);
+// 后台命令的标准输入、输出和错误都指向 /dev/null
+void hide_inout(SpawnPlan &plan) {
+  plan.Open(0, "/dev/null", O_RDWR, 0);
+  plan.Dup2(0, 1);
+  plan.Dup2(0, 2);
 }
 
-void wait(std::vector<pid_t> &bg_pids) {
-  for (size_t i = 0; i < bg_pids.size(); i++) {
-    int status;
-    waitpid(bg_pids[i], &status, 0);
-    if (WIFEXITED(status)) {
-      std::cout << "Process " << bg_pids[i] << " exited with status "
-                << WEXITSTATUS(status) << std::endl;
-    } else if (WIFSIGNALED(status)) {
-      std::cout << "Process " << bg_pids[i] << " terminated by signal "
-                << WTERMSIG(status) << std::endl;
+// 等待 job 结束并逐个报告其中进程的退出状态，返回 job 的退出码
+int wait(Job *job) {
+  jobs.Wait(job);
+  for (const Process &p : job->procs) {
+    if (WIFEXITED(p.status)) {
+      std::cout << "Process " << p.pid << " exited with status "
+                << WEXITSTATUS(p.status) << std::endl;
+    } else if (WIFSIGNALED(p.status)) {
+      std::cout << "Process " << p.pid << " terminated by signal "
+                << WTERMSIG(p.status) << std::endl;
     }
   }
-}
\ No newline at end of file
+  int code = WaitStatusToCode(job->LastStatus());
+  jobs.Remove(job);
+  return code;
+}
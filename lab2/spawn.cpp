@@ -0,0 +1,72 @@
+#include "spawn.hpp"
+
+// errno
+#include <cerrno>
+// sigset_t
+#include <signal.h>
+
+extern char **environ;
+
+SpawnPlan::SpawnPlan() : flags_(POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK) {
+  posix_spawn_file_actions_init(&actions_);
+  posix_spawnattr_init(&attr_);
+
+  // shell 自己处理或忽略的信号在子进程中恢复默认行为
+  sigset_t sigdef;
+  sigemptyset(&sigdef);
+  sigaddset(&sigdef, SIGINT);
+  sigaddset(&sigdef, SIGQUIT);
+  sigaddset(&sigdef, SIGTSTP);
+  sigaddset(&sigdef, SIGTTIN);
+  sigaddset(&sigdef, SIGTTOU);
+  sigaddset(&sigdef, SIGCHLD);
+  sigaddset(&sigdef, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attr_, &sigdef);
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr_, &mask);
+}
+
+SpawnPlan::~SpawnPlan() {
+  posix_spawnattr_destroy(&attr_);
+  posix_spawn_file_actions_destroy(&actions_);
+}
+
+void SpawnPlan::Dup2(int from, int to) {
+  posix_spawn_file_actions_adddup2(&actions_, from, to);
+}
+
+void SpawnPlan::Open(int fd, const char *path, int flags, mode_t mode) {
+  posix_spawn_file_actions_addopen(&actions_, fd, path, flags, mode);
+}
+
+void SpawnPlan::Close(int fd) {
+  posix_spawn_file_actions_addclose(&actions_, fd);
+}
+
+void SpawnPlan::SetProcessGroup(pid_t pgid) {
+  flags_ |= POSIX_SPAWN_SETPGROUP;
+  posix_spawnattr_setpgroup(&attr_, pgid);
+}
+
+void SpawnPlan::SetForeground(int ttyfd) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 35)
+  posix_spawn_file_actions_addtcsetpgrp_np(&actions_, ttyfd);
+#else
+  // 旧版本 glibc 没有这个文件动作，只能依赖父进程在 spawn 之后调用 tcsetpgrp
+  (void)ttyfd;
+#endif
+}
+
+pid_t SpawnPlan::Spawn(const char *path, char *const argv[]) {
+  posix_spawnattr_setflags(&attr_, flags_);
+
+  pid_t pid;
+  int err = posix_spawn(&pid, path, &actions_, &attr_, argv, environ);
+  if (err != 0) {
+    errno = err;
+    return -1;
+  }
+  return pid;
+}
@@ -0,0 +1,46 @@
+#ifndef SPAWN_HPP
+#define SPAWN_HPP
+
+// posix_spawn
+#include <spawn.h>
+// pid_t, mode_t
+#include <sys/types.h>
+
+// 对 posix_spawn 的一层封装。
+// glibc 的 posix_spawn 基于 clone(CLONE_VM|CLONE_VFORK)，子进程直接共享父进程的地址空间，
+// 不需要像 fork 那样复制页表，shell 的堆再大创建进程的开销也不变。
+// 重定向、管道和进程组都以“文件动作/属性”的形式记录下来，由子进程在 exec 之前依次执行。
+class SpawnPlan {
+public:
+  SpawnPlan();
+  ~SpawnPlan();
+  SpawnPlan(const SpawnPlan &) = delete;
+  SpawnPlan &operator=(const SpawnPlan &) = delete;
+
+  // 子进程中执行 dup2(from, to)
+  void Dup2(int from, int to);
+
+  // 子进程中在 fd 上打开 path
+  void Open(int fd, const char *path, int flags, mode_t mode);
+
+  // 子进程中关闭 fd
+  void Close(int fd);
+
+  // 子进程加入进程组 pgid，0 表示以自己的 pid 新建进程组
+  void SetProcessGroup(pid_t pgid);
+
+  // 子进程在 exec 前把自己的进程组设为终端 ttyfd 的前台进程组
+  void SetForeground(int ttyfd);
+
+  // 创建子进程执行 path 处的程序，path 需已由调用者解析（见 CommandHash），不再搜索 PATH。
+  // 成功返回子进程 pid；失败返回 -1 并设置 errno（如文件不存在时为 ENOENT）。
+  // 同一个 plan 可以多次 Spawn
+  pid_t Spawn(const char *path, char *const argv[]);
+
+private:
+  posix_spawn_file_actions_t actions_;
+  posix_spawnattr_t attr_;
+  short flags_;
+};
+
+#endif // SPAWN_HPP
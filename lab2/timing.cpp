@@ -0,0 +1,188 @@
+#include "timing.hpp"
+
+// std::sort
+#include <algorithm>
+// snprintf
+#include <cstdio>
+// std::string
+#include <string>
+// WIFEXITED 等
+#include <sys/wait.h>
+
+namespace {
+
+double Seconds(const struct timeval &tv) {
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+double Elapsed(const struct timespec &from, const struct timespec &to) {
+  return (to.tv_sec - from.tv_sec) + (to.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+struct timespec Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts;
+}
+
+// bash 的格式：0m0.302s
+std::string Clock(double sec) {
+  char buf[64];
+  int min = static_cast<int>(sec / 60);
+  snprintf(buf, sizeof(buf), "%dm%.3fs", min, sec - min * 60);
+  return buf;
+}
+
+std::string Fixed(double sec) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.6f", sec);
+  return buf;
+}
+
+void JsonString(std::ostream &os, std::string_view s) {
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      os << buf;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+} // namespace
+
+void PipelineTimer::Start() {
+  stages_.clear();
+  start_ = Now();
+}
+
+void PipelineTimer::Spawned(size_t stage, pid_t pid, std::string_view cmd) {
+  Stage s{};
+  s.index = stage;
+  s.pid = pid;
+  s.cmd = cmd;
+  stages_.push_back(s);
+}
+
+void PipelineTimer::BeginBuiltin() {
+  getrusage(RUSAGE_SELF, &builtinStart_);
+}
+
+void PipelineTimer::EndBuiltin(size_t stage, std::string_view cmd, int code) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  Stage s{};
+  s.index = stage;
+  s.pid = 0;
+  s.cmd = cmd;
+  s.code = code;
+  // 内建命令与其余各段同时开始，实际耗时从管道开始算起
+  s.real = Elapsed(start_, Now());
+  s.user = Seconds(ru.ru_utime) - Seconds(builtinStart_.ru_utime);
+  s.sys = Seconds(ru.ru_stime) - Seconds(builtinStart_.ru_stime);
+  s.maxrss = ru.ru_maxrss; // 只能得到 shell 进程自己的峰值
+  s.nvcsw = ru.ru_nvcsw - builtinStart_.ru_nvcsw;
+  s.nivcsw = ru.ru_nivcsw - builtinStart_.ru_nivcsw;
+  s.minflt = ru.ru_minflt - builtinStart_.ru_minflt;
+  s.majflt = ru.ru_majflt - builtinStart_.ru_majflt;
+  stages_.push_back(s);
+}
+
+void PipelineTimer::Collect(const Job &job) {
+  for (Stage &s : stages_) {
+    if (s.pid == 0) {
+      continue;
+    }
+    for (const Process &p : job.procs) {
+      if (p.pid != s.pid || !p.done) {
+        continue;
+      }
+      const struct rusage &ru = p.usage;
+      s.code = WIFSIGNALED(p.status) ? 128 + WTERMSIG(p.status)
+                                     : WEXITSTATUS(p.status);
+      s.real = Elapsed(start_, p.end);
+      s.user = Seconds(ru.ru_utime);
+      s.sys = Seconds(ru.ru_stime);
+      s.maxrss = ru.ru_maxrss;
+      s.nvcsw = ru.ru_nvcsw;
+      s.nivcsw = ru.ru_nivcsw;
+      s.minflt = ru.ru_minflt;
+      s.majflt = ru.ru_majflt;
+      break;
+    }
+  }
+}
+
+void PipelineTimer::Report(std::ostream &os, std::string_view cmdline,
+                           int code, bool json) {
+  double real = Elapsed(start_, Now());
+  std::sort(stages_.begin(), stages_.end(),
+            [](const Stage &a, const Stage &b) { return a.index < b.index; });
+
+  // 合计：时间和计数求和，内存取各段峰值的最大值
+  Stage total{};
+  for (const Stage &s : stages_) {
+    total.user += s.user;
+    total.sys += s.sys;
+    total.maxrss = std::max(total.maxrss, s.maxrss);
+    total.nvcsw += s.nvcsw;
+    total.nivcsw += s.nivcsw;
+    total.minflt += s.minflt;
+    total.majflt += s.majflt;
+  }
+
+  if (json) {
+    os << "{\"command\":";
+    JsonString(os, cmdline);
+    os << ",\"status\":" << code << ",\"real\":" << Fixed(real)
+       << ",\"user\":" << Fixed(total.user) << ",\"sys\":" << Fixed(total.sys)
+       << ",\"maxrss_kib\":" << total.maxrss << ",\"nvcsw\":" << total.nvcsw
+       << ",\"nivcsw\":" << total.nivcsw << ",\"minflt\":" << total.minflt
+       << ",\"majflt\":" << total.majflt << ",\"stages\":[";
+    for (size_t i = 0; i < stages_.size(); i++) {
+      const Stage &s = stages_[i];
+      os << (i ? "," : "") << "{\"stage\":" << s.index + 1
+         << ",\"command\":";
+      JsonString(os, s.cmd);
+      os << ",\"pid\":" << s.pid << ",\"builtin\":"
+         << (s.pid == 0 ? "true" : "false") << ",\"status\":" << s.code
+         << ",\"real\":" << Fixed(s.real) << ",\"user\":" << Fixed(s.user)
+         << ",\"sys\":" << Fixed(s.sys) << ",\"maxrss_kib\":" << s.maxrss
+         << ",\"nvcsw\":" << s.nvcsw << ",\"nivcsw\":" << s.nivcsw
+         << ",\"minflt\":" << s.minflt << ",\"majflt\":" << s.majflt << "}";
+    }
+    os << "]}" << std::endl;
+    return;
+  }
+
+  os << "\nreal\t" << Clock(real) << "\nuser\t" << Clock(total.user)
+     << "\nsys\t" << Clock(total.sys) << "\nmaxrss\t" << total.maxrss
+     << " KiB\nctxsw\t" << total.nvcsw << " voluntary, " << total.nivcsw
+     << " involuntary\nfaults\t" << total.minflt << " minor, " << total.majflt
+     << " major\n";
+
+  if (stages_.size() > 1) {
+    // 分段表格：real 为该段从管道开始到结束的时间，最慢的一段就是瓶颈
+    char line[256];
+    snprintf(line, sizeof(line), "%-6s%10s%10s%10s%12s%14s%16s  %s\n", "stage",
+             "real", "user", "sys", "maxrss(KiB)", "ctxsw(v/iv)",
+             "faults(min/maj)", "command");
+    os << line;
+    for (const Stage &s : stages_) {
+      std::string ctxsw = std::to_string(s.nvcsw) + "/" + std::to_string(s.nivcsw);
+      std::string faults =
+          std::to_string(s.minflt) + "/" + std::to_string(s.majflt);
+      snprintf(line, sizeof(line), "%-6zu%10.3f%10.3f%10.3f%12ld%14s%16s  ",
+               s.index + 1, s.real, s.user, s.sys, s.maxrss, ctxsw.c_str(),
+               faults.c_str());
+      os << line << s.cmd << (s.pid == 0 ? " (builtin)" : "") << "\n";
+    }
+  }
+  os.flush();
+}
@@ -0,0 +1,56 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+// std::ostream
+#include <ostream>
+// std::string_view
+#include <string_view>
+// std::vector
+#include <vector>
+// struct rusage
+#include <sys/resource.h>
+// pid_t
+#include <sys/types.h>
+// struct timespec
+#include <time.h>
+
+#include "jobs.hpp"
+
+// time 关键字的计时器，记录一条前台管道中每一段的资源使用情况。
+// 外部命令的数据来自 wait4 返回的 rusage（见 JobTable），
+// 在 shell 中执行的内建命令取前后两次 getrusage(RUSAGE_SELF) 之差。
+class PipelineTimer {
+public:
+  // 开始计时，在创建第一段之前调用
+  void Start();
+
+  // 第 stage 段（从 0 开始）已创建为进程 pid
+  void Spawned(size_t stage, pid_t pid, std::string_view cmd);
+
+  // 第 stage 段是在 shell 中执行的内建命令，在执行前后各调用一次
+  void BeginBuiltin();
+  void EndBuiltin(size_t stage, std::string_view cmd, int code);
+
+  // job 结束后、从作业表删除前调用，取出各进程的 rusage
+  void Collect(const Job &job);
+
+  // 结束计时并输出报告。json 为 false 时是 bash 风格的文本，多段管道附带分段表格
+  void Report(std::ostream &os, std::string_view cmdline, int code, bool json);
+
+private:
+  struct Stage {
+    size_t index;
+    pid_t pid; // 在 shell 中执行的内建命令为 0
+    std::string_view cmd;
+    int code = 0;
+    double real = 0, user = 0, sys = 0;
+    long maxrss = 0; // KiB
+    long nvcsw = 0, nivcsw = 0, minflt = 0, majflt = 0;
+  };
+
+  struct timespec start_ {};
+  struct rusage builtinStart_ {};
+  std::vector<Stage> stages_;
+};
+
+#endif // TIMING_HPP
@@ -0,0 +1,555 @@
+// 静态文件服务器的压测工具。-c 个线程同时请求命令行给出的路径（依次轮流使用），
+// 可以用 HTTP/1.0（和 siege 一样，每个请求一个连接）或者 h2c（prior knowledge，
+// 每个线程一个连接，连接上同时有 -m 个流）。
+// 输出请求数、吞吐量、建立的连接数、请求头和响应头的字节数以及延迟的分位数。
+//
+// 用法: loadgen [-p h1|h2] [-c 线程数] [-n 总请求数] [-m 每个连接的并发流数]
+//               [-a 地址] [-P 端口] 路径...
+// 例如模拟一个引用了很多图片的页面: loadgen -p h2 -c 4 -m 32 -n 20000 /image-1.png /image-2.png ...
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hpack.h"
+
+#define USER_AGENT "loadgen"
+#define BUF_SIZE 65536
+#define MAX_VALUE_LEN 256
+
+#define H2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_FRAME_HEADER_LEN 9
+#define H2_MAX_WINDOW 0x7fffffff
+
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+
+struct options {
+    int h2;
+    int threads;
+    long requests;
+    int streams;
+    const char *addr;
+    int port;
+    char **paths;
+    int npaths;
+};
+
+static struct options opts = {0, 4, 10000, 16, "127.0.0.1", 8000, NULL, 0};
+
+struct worker {
+    pthread_t tid;
+    int index;
+    long requests; // 这个线程要发出的请求数
+    long done, failed, connections;
+    uint64_t request_header_bytes, response_header_bytes, body_bytes;
+    double *latency; // 每个成功请求的延迟，毫秒
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *next_path(struct worker *w, long k)
+{
+    return opts.paths[(w->index + k) % opts.npaths];
+}
+
+static int connect_server(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(opts.addr);
+    addr.sin_port = htons(opts.port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// HTTP/1.0：每个请求建立一个连接，服务器发完响应后关闭连接
+static void run_h1(struct worker *w)
+{
+    char req[MAX_VALUE_LEN + 128];
+    char *buf = (char *)malloc(BUF_SIZE);
+
+    for (long k = 0; k < w->requests; k++) {
+        int len = snprintf(req, sizeof(req),
+                           "GET %s HTTP/1.0\r\nHost: %s:%d\r\nUser-Agent: " USER_AGENT
+                           "\r\nAccept: */*\r\n\r\n",
+                           next_path(w, k), opts.addr, opts.port);
+        uint64_t start = now_ns();
+        int fd = connect_server();
+        if (fd < 0) {
+            w->failed++;
+            continue;
+        }
+        w->connections++;
+        if (write_all(fd, req, len) < 0) {
+            close(fd);
+            w->failed++;
+            continue;
+        }
+        w->request_header_bytes += len;
+
+        // 响应头读完之前保留在 buf 中，之后的响应体只统计字节数
+        size_t got = 0, header_len = 0;
+        uint64_t total = 0;
+        int ok = 0;
+        ssize_t n;
+        while ((n = read(fd, buf + got, BUF_SIZE - got)) > 0) {
+            total += n;
+            if (header_len == 0) {
+                got += n;
+                char *end = memmem(buf, got, "\r\n\r\n", 4);
+                if (end != NULL) {
+                    header_len = end + 4 - buf;
+                    ok = strncmp(buf, "HTTP/1.0 200", 12) == 0;
+                    got = 0;
+                } else if (got == BUF_SIZE) {
+                    break;
+                }
+            }
+        }
+        close(fd);
+
+        if (n < 0 || !ok) {
+            w->failed++;
+            continue;
+        }
+        w->response_header_bytes += header_len;
+        w->body_bytes += total - header_len;
+        w->latency[w->done++] = (now_ns() - start) / 1e6;
+    }
+    free(buf);
+}
+
+// 客户端这一侧的 HPACK 动态表，只需要知道加入过哪些头部以及它们现在的下标，
+// 淘汰规则和服务器的解码端（默认 4096 字节）一致
+struct encoder_entry {
+    unsigned name_index;
+    char value[MAX_VALUE_LEN];
+    size_t len, size;
+};
+
+struct encoder_table {
+    struct encoder_entry entries[HPACK_DEFAULT_TABLE_SIZE / 32];
+    int count; // entries[0] 是最新的一项，下标为 62
+    size_t size;
+};
+
+static size_t encode_header(struct encoder_table *t, uint8_t *out, unsigned name_index,
+                            size_t name_len, const char *value)
+{
+    size_t len = strlen(value);
+    for (int i = 0; i < t->count; i++) {
+        struct encoder_entry *e = &t->entries[i];
+        if (e->name_index == name_index && e->len == len && memcmp(e->value, value, len) == 0) {
+            return hpack_encode_indexed(out, HPACK_STATIC_COUNT + 1 + i);
+        }
+    }
+
+    size_t size = name_len + len + 32;
+    if (len >= MAX_VALUE_LEN || size > HPACK_DEFAULT_TABLE_SIZE) {
+        return hpack_encode_literal(out, name_index, value, len);
+    }
+    while (t->count > 0 && t->size + size > HPACK_DEFAULT_TABLE_SIZE) {
+        t->size -= t->entries[--t->count].size;
+    }
+    memmove(&t->entries[1], &t->entries[0], t->count * sizeof(struct encoder_entry));
+    struct encoder_entry *e = &t->entries[0];
+    e->name_index = name_index;
+    memcpy(e->value, value, len);
+    e->len = len;
+    e->size = size;
+    t->count++;
+    t->size += size;
+    return hpack_encode_literal_incremental(out, name_index, value, len);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void frame_header(uint8_t *p, size_t len, uint8_t type, uint8_t flags, uint32_t id)
+{
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    put_u32(p + 5, id);
+}
+
+// 在 out 末尾追加一帧，返回追加的字节数
+static size_t append_frame(uint8_t *out, uint8_t type, uint8_t flags, uint32_t id,
+                           const uint8_t *payload, size_t len)
+{
+    frame_header(out, len, type, flags, id);
+    if (len > 0) {
+        memcpy(out + H2_FRAME_HEADER_LEN, payload, len);
+    }
+    return H2_FRAME_HEADER_LEN + len;
+}
+
+struct h2_slot {
+    uint32_t id; // 0 表示空闲
+    uint64_t start;
+    int status;
+};
+
+static int on_status(void *arg, const char *name, size_t name_len, const char *value,
+                     size_t value_len)
+{
+    if (name_len == 7 && memcmp(name, ":status", 7) == 0) {
+        // 值不一定以 '\0' 结尾
+        *(int *)arg = value_len == 3 ? (value[0] - '0') * 100 + (value[1] - '0') * 10 +
+                                           (value[2] - '0')
+                                     : 0;
+    }
+    return 0;
+}
+
+static void finish_stream(struct worker *w, struct h2_slot *slot, int ok)
+{
+    if (ok && slot->status == 200) {
+        w->latency[w->done++] = (now_ns() - slot->start) / 1e6;
+    } else {
+        w->failed++;
+    }
+    slot->id = 0;
+}
+
+// h2c：一个连接，始终保持 opts.streams 个请求在途
+static void run_h2(struct worker *w)
+{
+    int fd = connect_server();
+    if (fd < 0) {
+        w->failed += w->requests;
+        return;
+    }
+    w->connections++;
+
+    struct h2_slot *slots = (struct h2_slot *)calloc(opts.streams, sizeof(struct h2_slot));
+    struct encoder_table *enc = (struct encoder_table *)calloc(1, sizeof(struct encoder_table));
+    uint8_t *in = (uint8_t *)malloc(BUF_SIZE);
+    uint8_t *out = (uint8_t *)malloc(2 * BUF_SIZE); // 请求之外还要放确认帧
+    struct hpack_table dec;
+    hpack_table_init(&dec, HPACK_DEFAULT_TABLE_SIZE);
+
+    // 连接前言，把流和连接的接收窗口都开到最大，只在连接窗口用掉一半时补充
+    size_t out_len = strlen(H2_PREFACE);
+    memcpy(out, H2_PREFACE, out_len);
+    uint8_t settings[6] = {0, H2_SETTINGS_INITIAL_WINDOW_SIZE};
+    put_u32(settings + 2, H2_MAX_WINDOW);
+    out_len += append_frame(out + out_len, H2_SETTINGS, 0, 0, settings, sizeof(settings));
+    uint8_t inc[4];
+    put_u32(inc, H2_MAX_WINDOW - 65535);
+    out_len += append_frame(out + out_len, H2_WINDOW_UPDATE, 0, 0, inc, sizeof(inc));
+    uint64_t unacked = 0;
+
+    size_t in_len = 0;
+    long issued = 0, inflight = 0;
+    uint32_t next_id = 1;
+    int alive = 1;
+    while (alive && (issued < w->requests || inflight > 0)) {
+        for (int i = 0; i < opts.streams && issued < w->requests; i++) {
+            if (slots[i].id != 0 || out_len + 512 > BUF_SIZE) {
+                continue;
+            }
+            const char *path = next_path(w, issued);
+            char authority[64];
+            snprintf(authority, sizeof(authority), "%s:%d", opts.addr, opts.port);
+            uint8_t *p = out + out_len + H2_FRAME_HEADER_LEN;
+            size_t n = hpack_encode_indexed(p, HPACK_METHOD_GET);
+            n += hpack_encode_indexed(p + n, HPACK_SCHEME_HTTP);
+            n += encode_header(enc, p + n, HPACK_AUTHORITY, 10, authority);
+            n += encode_header(enc, p + n, HPACK_PATH, 5, path);
+            n += encode_header(enc, p + n, HPACK_USER_AGENT, 10, USER_AGENT);
+            n += encode_header(enc, p + n, HPACK_ACCEPT, 6, "*/*");
+            frame_header(out + out_len, n, H2_HEADERS, H2_FLAG_END_STREAM | H2_FLAG_END_HEADERS,
+                         next_id);
+            out_len += H2_FRAME_HEADER_LEN + n;
+            w->request_header_bytes += H2_FRAME_HEADER_LEN + n;
+
+            slots[i].id = next_id;
+            slots[i].start = now_ns();
+            slots[i].status = 0;
+            next_id += 2;
+            issued++;
+            inflight++;
+        }
+        if (out_len > 0) {
+            if (write_all(fd, out, out_len) < 0) {
+                break;
+            }
+            out_len = 0;
+        }
+
+        ssize_t n = read(fd, in + in_len, BUF_SIZE - in_len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        in_len += n;
+
+        size_t pos = 0;
+        while (in_len - pos >= H2_FRAME_HEADER_LEN) {
+            const uint8_t *h = in + pos;
+            size_t len = (size_t)h[0] << 16 | h[1] << 8 | h[2];
+            if (in_len - pos < H2_FRAME_HEADER_LEN + len) {
+                break;
+            }
+            uint8_t type = h[3], flags = h[4];
+            uint32_t id = ((uint32_t)h[5] << 24 | h[6] << 16 | h[7] << 8 | h[8]) & 0x7fffffff;
+            const uint8_t *payload = h + H2_FRAME_HEADER_LEN;
+            pos += H2_FRAME_HEADER_LEN + len;
+
+            struct h2_slot *slot = NULL;
+            for (int i = 0; i < opts.streams && id != 0; i++) {
+                if (slots[i].id == id) {
+                    slot = &slots[i];
+                }
+            }
+
+            if (type == H2_SETTINGS && !(flags & H2_FLAG_ACK)) {
+                out_len += append_frame(out + out_len, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+            } else if (type == H2_PING && !(flags & H2_FLAG_ACK)) {
+                out_len += append_frame(out + out_len, H2_PING, H2_FLAG_ACK, 0, payload, len);
+            } else if (type == H2_HEADERS) {
+                // 服务器的响应头很短，不会用到 CONTINUATION
+                const uint8_t *block = payload;
+                size_t block_len = len;
+                if (flags & H2_FLAG_PADDED) {
+                    block_len -= 1 + block[0];
+                    block++;
+                }
+                if (flags & H2_FLAG_PRIORITY) {
+                    block += 5;
+                    block_len -= 5;
+                }
+                int status = 0;
+                if (hpack_decode(&dec, block, block_len, on_status, &status) != 0) {
+                    alive = 0;
+                }
+                w->response_header_bytes += H2_FRAME_HEADER_LEN + len;
+                if (slot != NULL) {
+                    slot->status = status;
+                    if (flags & H2_FLAG_END_STREAM) {
+                        finish_stream(w, slot, 1);
+                        inflight--;
+                    }
+                }
+            } else if (type == H2_DATA) {
+                w->body_bytes += len;
+                unacked += len;
+                if (slot != NULL && (flags & H2_FLAG_END_STREAM)) {
+                    finish_stream(w, slot, 1);
+                    inflight--;
+                }
+            } else if (type == H2_RST_STREAM && slot != NULL) {
+                finish_stream(w, slot, 0);
+                inflight--;
+            } else if (type == H2_GOAWAY) {
+                alive = 0;
+            }
+        }
+        memmove(in, in + pos, in_len - pos);
+        in_len -= pos;
+
+        if (unacked > H2_MAX_WINDOW / 2) {
+            put_u32(inc, unacked);
+            out_len += append_frame(out + out_len, H2_WINDOW_UPDATE, 0, 0, inc, sizeof(inc));
+            unacked = 0;
+        }
+    }
+
+    // 连接提前结束时，在途的和没有发出的请求都算失败
+    w->failed += inflight + (w->requests - issued);
+    hpack_table_free(&dec);
+    free(slots);
+    free(enc);
+    free(in);
+    free(out);
+    close(fd);
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    if (opts.h2) {
+        run_h2(w);
+    } else {
+        run_h1(w);
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-p h1|h2] [-c threads] [-n requests] [-m streams] [-a addr] [-P port] "
+            "path...\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "p:c:n:m:a:P:")) != -1) {
+        switch (opt) {
+        case 'p':
+            if (strcmp(optarg, "h1") == 0) {
+                opts.h2 = 0;
+            } else if (strcmp(optarg, "h2") == 0) {
+                opts.h2 = 1;
+            } else {
+                usage(argv[0]);
+            }
+            break;
+        case 'c':
+            opts.threads = atoi(optarg);
+            break;
+        case 'n':
+            opts.requests = atol(optarg);
+            break;
+        case 'm':
+            opts.streams = atoi(optarg);
+            break;
+        case 'a':
+            opts.addr = optarg;
+            break;
+        case 'P':
+            opts.port = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind == argc || opts.threads <= 0 || opts.requests <= 0 || opts.streams <= 0) {
+        usage(argv[0]);
+    }
+    opts.paths = argv + optind;
+    opts.npaths = argc - optind;
+    for (int i = 0; i < opts.npaths; i++) {
+        if (strlen(opts.paths[i]) >= MAX_VALUE_LEN) {
+            fprintf(stderr, "path too long: %s\n", opts.paths[i]);
+            return 2;
+        }
+    }
+
+    struct worker *workers = (struct worker *)calloc(opts.threads, sizeof(struct worker));
+    uint64_t start = now_ns();
+    for (int i = 0; i < opts.threads; i++) {
+        struct worker *w = &workers[i];
+        w->index = i;
+        w->requests = opts.requests / opts.threads + (i < opts.requests % opts.threads);
+        w->latency = (double *)malloc(sizeof(double) * (w->requests + 1));
+        pthread_create(&w->tid, NULL, worker_main, w);
+    }
+
+    struct worker sum;
+    memset(&sum, 0, sizeof(sum));
+    double *latency = (double *)malloc(sizeof(double) * (opts.requests + 1));
+    for (int i = 0; i < opts.threads; i++) {
+        struct worker *w = &workers[i];
+        pthread_join(w->tid, NULL);
+        memcpy(latency + sum.done, w->latency, sizeof(double) * w->done);
+        sum.done += w->done;
+        sum.failed += w->failed;
+        sum.connections += w->connections;
+        sum.request_header_bytes += w->request_header_bytes;
+        sum.response_header_bytes += w->response_header_bytes;
+        sum.body_bytes += w->body_bytes;
+        free(w->latency);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    qsort(latency, sum.done, sizeof(double), cmp_double);
+
+    long n = sum.done > 0 ? sum.done : 1;
+    printf("protocol               %s\n", opts.h2 ? "h2c" : "HTTP/1.0");
+    printf("threads                %d\n", opts.threads);
+    if (opts.h2) {
+        printf("streams per connection %d\n", opts.streams);
+    }
+    printf("requests               %ld ok, %ld failed\n", sum.done, sum.failed);
+    printf("connections            %ld\n", sum.connections);
+    printf("elapsed                %.3f s\n", seconds);
+    printf("requests/s             %.1f\n", sum.done / seconds);
+    printf("body throughput        %.2f MiB/s\n", sum.body_bytes / seconds / (1 << 20));
+    printf("request header bytes   %llu (%.1f per request)\n",
+           (unsigned long long)sum.request_header_bytes, (double)sum.request_header_bytes / n);
+    printf("response header bytes  %llu (%.1f per request)\n",
+           (unsigned long long)sum.response_header_bytes, (double)sum.response_header_bytes / n);
+    if (sum.done > 0) {
+        printf("latency ms             p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+               latency[sum.done / 2], latency[sum.done * 9 / 10], latency[sum.done * 99 / 100],
+               latency[sum.done - 1]);
+    }
+
+    free(latency);
+    free(workers);
+    return sum.failed > 0;
+}
@@ -0,0 +1,1085 @@
+// h2.c
+#define _GNU_SOURCE
+#include "h2.h"
+#include "hpack.h"
+#include "server.h"
+
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <strings.h>
+
+#define H2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_PREFACE_LEN 24
+#define H2_FRAME_HEADER_LEN 9
+
+#define H2_DEFAULT_WINDOW 65535
+#define H2_MAX_WINDOW 0x7fffffff
+#define H2_DEFAULT_FRAME_SIZE 16384
+#define H2_MAX_FRAME_SIZE 16777215
+
+#define H2_MAX_STREAMS 100          // 通告的 SETTINGS_MAX_CONCURRENT_STREAMS
+#define H2_MAX_HEADER_BLOCK 65536   // HEADERS 加 CONTINUATION 的总长度上限
+#define H2_IN_BUF_SIZE 65536
+#define H2_OUT_HIGH (256 * 1024)    // 待发送的数据超过这么多时不再读文件
+#define H2_IDLE_TIMEOUT_MS 30000    // 没有进行中的请求时，空闲这么久就关闭连接
+
+// 帧类型
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_PRIORITY 0x2
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PUSH_PROMISE 0x5
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_CONTINUATION 0x9
+
+// 帧标志
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+// 错误码
+#define H2_NO_ERROR 0x0
+#define H2_PROTOCOL_ERROR 0x1
+#define H2_INTERNAL_ERROR 0x2
+#define H2_FLOW_CONTROL_ERROR 0x3
+#define H2_STREAM_CLOSED 0x5
+#define H2_FRAME_SIZE_ERROR 0x6
+#define H2_REFUSED_STREAM 0x7
+#define H2_COMPRESSION_ERROR 0x9
+#define H2_ENHANCE_YOUR_CALM 0xb
+
+// SETTINGS 参数
+#define H2_SETTINGS_ENABLE_PUSH 0x2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+// 流的状态，只记录还没有结束的流
+#define H2_STREAM_OPEN 1    // 请求还没有收完（等待 END_STREAM）
+#define H2_STREAM_SENDING 2 // 请求已经收完，正在发送响应体
+
+// 连接前言的进度
+#define H2_WAIT_PREFACE 0
+#define H2_WAIT_SETTINGS 1
+#define H2_READY 2
+
+struct h2_stream {
+    uint32_t id; // 0 表示这个槽空闲
+    int state;
+    int is_get;
+    int fd;
+    off_t remaining;
+    int64_t window; // 发送窗口，对方调小初始窗口后可能为负
+    char path[MAX_PATH_LEN];
+    size_t path_len;
+};
+
+struct h2_conn {
+    int sock;
+    int preface;
+    struct hpack_table decoder;
+
+    uint8_t *in;
+    size_t in_len, in_cap;
+    uint8_t *out; // out[out_pos, out_len) 是还没有写出的数据
+    size_t out_pos, out_len, out_cap;
+
+    struct h2_stream streams[H2_MAX_STREAMS];
+    int active;
+    int next; // 轮转发送的起点
+    uint32_t last_stream_id;
+
+    int64_t send_window; // 连接级的发送窗口
+    uint32_t peer_initial_window;
+    uint32_t peer_max_frame;
+
+    // 正在接收的头部块（HEADERS 后面跟着 CONTINUATION）
+    uint32_t block_stream;
+    int block_end_stream;
+    uint8_t *block;
+    size_t block_len;
+
+    int goaway;      // 收到 GOAWAY：不再接受新的流，发完已有的响应就关闭
+    int closing;     // 已经发送 GOAWAY：把缓冲区写完就关闭
+    int peer_closed; // 对方关闭了写端
+    int failed;      // 写失败或内存不足，直接关闭
+};
+
+// 解码请求头时记录的信息。解码必须进行到头部块末尾，否则动态表会和对方不一致，
+// 因此遇到错误只做标记，解码完再回复 RST_STREAM
+struct h2_request {
+    int has_method, has_scheme, has_path;
+    int is_get;
+    int regular; // 已经出现过普通头部，之后不能再有伪头部
+    int error;
+    char path[MAX_PATH_LEN];
+    size_t path_len;
+};
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static size_t out_pending(const struct h2_conn *c)
+{
+    return c->out_len - c->out_pos;
+}
+
+// 在输出缓冲区末尾留出 n 字节，返回写入的位置
+static uint8_t *out_reserve(struct h2_conn *c, size_t n)
+{
+    if (c->out_len + n > c->out_cap && c->out_pos > 0) {
+        memmove(c->out, c->out + c->out_pos, out_pending(c));
+        c->out_len -= c->out_pos;
+        c->out_pos = 0;
+    }
+    if (c->out_len + n > c->out_cap) {
+        size_t cap = c->out_cap * 2;
+        while (cap < c->out_len + n) {
+            cap *= 2;
+        }
+        uint8_t *out = (uint8_t *)realloc(c->out, cap);
+        if (out == NULL) {
+            perror("h2 out buffer realloc failed");
+            c->failed = 1;
+            return NULL;
+        }
+        c->out = out;
+        c->out_cap = cap;
+    }
+    return c->out + c->out_len;
+}
+
+static void frame_header(uint8_t *p, size_t len, uint8_t type, uint8_t flags, uint32_t id)
+{
+    p[0] = len >> 16;
+    p[1] = len >> 8;
+    p[2] = len;
+    p[3] = type;
+    p[4] = flags;
+    put_u32(p + 5, id & 0x7fffffff);
+}
+
+static void send_frame(struct h2_conn *c, uint8_t type, uint8_t flags, uint32_t id,
+                       const uint8_t *payload, size_t len)
+{
+    uint8_t *p = out_reserve(c, H2_FRAME_HEADER_LEN + len);
+    if (p == NULL) {
+        return;
+    }
+    frame_header(p, len, type, flags, id);
+    if (len > 0) {
+        memcpy(p + H2_FRAME_HEADER_LEN, payload, len);
+    }
+    c->out_len += H2_FRAME_HEADER_LEN + len;
+}
+
+static void send_u32(struct h2_conn *c, uint8_t type, uint32_t id, uint32_t value)
+{
+    uint8_t payload[4];
+    put_u32(payload, value);
+    send_frame(c, type, 0, id, payload, sizeof(payload));
+}
+
+// 连接错误：发送 GOAWAY，之后不再处理收到的帧，写完缓冲区就关闭连接
+static void connection_error(struct h2_conn *c, uint32_t code)
+{
+    if (c->closing) {
+        return;
+    }
+    uint8_t payload[8];
+    put_u32(payload, c->last_stream_id);
+    put_u32(payload + 4, code);
+    send_frame(c, H2_GOAWAY, 0, 0, payload, sizeof(payload));
+    c->closing = 1;
+}
+
+static struct h2_stream *find_stream(struct h2_conn *c, uint32_t id)
+{
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (c->streams[i].id == id) {
+            return &c->streams[i];
+        }
+    }
+    return NULL;
+}
+
+static void free_stream(struct h2_conn *c, struct h2_stream *s)
+{
+    if (s->fd >= 0) {
+        close(s->fd);
+        s->fd = -1;
+    }
+    s->id = 0;
+    c->active--;
+}
+
+// 流错误：发送 RST_STREAM，流上的其他请求不受影响
+static void stream_error(struct h2_conn *c, uint32_t id, uint32_t code)
+{
+    send_u32(c, H2_RST_STREAM, id, code);
+    struct h2_stream *s = find_stream(c, id);
+    if (s != NULL) {
+        free_stream(c, s);
+    }
+}
+
+static void send_settings(struct h2_conn *c)
+{
+    uint8_t payload[6];
+    payload[0] = 0;
+    payload[1] = H2_SETTINGS_MAX_CONCURRENT_STREAMS;
+    put_u32(payload + 2, H2_MAX_STREAMS);
+    send_frame(c, H2_SETTINGS, 0, 0, payload, sizeof(payload));
+}
+
+// 应用对方的 SETTINGS，成功返回 0，否则返回应当使用的错误码
+static uint32_t apply_settings(struct h2_conn *c, const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i + 6 <= len; i += 6) {
+        uint16_t id = (uint16_t)(p[i] << 8 | p[i + 1]);
+        uint32_t value = get_u32(p + i + 2);
+        switch (id) {
+        case H2_SETTINGS_ENABLE_PUSH:
+            if (value > 1) {
+                return H2_PROTOCOL_ERROR;
+            }
+            break;
+        case H2_SETTINGS_INITIAL_WINDOW_SIZE:
+            // 新的初始窗口对所有已有的流生效，按差值调整
+            if (value > H2_MAX_WINDOW) {
+                return H2_FLOW_CONTROL_ERROR;
+            }
+            for (int k = 0; k < H2_MAX_STREAMS; k++) {
+                struct h2_stream *s = &c->streams[k];
+                if (s->id == 0) {
+                    continue;
+                }
+                s->window += (int64_t)value - c->peer_initial_window;
+                if (s->window > H2_MAX_WINDOW) {
+                    return H2_FLOW_CONTROL_ERROR;
+                }
+            }
+            c->peer_initial_window = value;
+            break;
+        case H2_SETTINGS_MAX_FRAME_SIZE:
+            if (value < H2_DEFAULT_FRAME_SIZE || value > H2_MAX_FRAME_SIZE) {
+                return H2_PROTOCOL_ERROR;
+            }
+            c->peer_max_frame = value;
+            break;
+        default:
+            // 响应头不使用动态表，HEADER_TABLE_SIZE 和其他参数都不影响服务器
+            break;
+        }
+    }
+    return 0;
+}
+
+// 请求结束，打开文件并发送响应头。和 HTTP/1.0 一样，方法不是 GET 时回复 500
+static void respond(struct h2_conn *c, struct h2_stream *s)
+{
+    struct stat file_type;
+    int file_fd = s->is_get ? open_file(s->path, s->path_len, &file_type) : ERR_INVALID_METHOD;
+
+    uint8_t block[64];
+    size_t n;
+    if (file_fd == ERR_NOT_FOUND) {
+        n = hpack_encode_indexed(block, HPACK_STATUS_404);
+    } else if (file_fd < 0) {
+        n = hpack_encode_indexed(block, HPACK_STATUS_500);
+    } else {
+        char len[32];
+        int len_len = snprintf(len, sizeof(len), "%lld", (long long)file_type.st_size);
+        n = hpack_encode_indexed(block, HPACK_STATUS_200);
+        n += hpack_encode_literal(block + n, HPACK_CONTENT_LENGTH, len, len_len);
+    }
+
+    if (file_fd < 0 || file_type.st_size == 0) {
+        send_frame(c, H2_HEADERS, H2_FLAG_END_HEADERS | H2_FLAG_END_STREAM, s->id, block, n);
+        if (file_fd >= 0) {
+            close(file_fd);
+        }
+        free_stream(c, s);
+        return;
+    }
+    send_frame(c, H2_HEADERS, H2_FLAG_END_HEADERS, s->id, block, n);
+    s->state = H2_STREAM_SENDING;
+    s->fd = file_fd;
+    s->remaining = file_type.st_size;
+}
+
+// 从文件读一帧 DATA 直接放进输出缓冲区
+static void send_data(struct h2_conn *c, struct h2_stream *s)
+{
+    int64_t len = s->remaining;
+    if (len > s->window) {
+        len = s->window;
+    }
+    if (len > c->send_window) {
+        len = c->send_window;
+    }
+    // 即使对方允许更大的帧也只发 16KB，让多个流的数据交错得更细
+    if (len > H2_DEFAULT_FRAME_SIZE) {
+        len = H2_DEFAULT_FRAME_SIZE;
+    }
+
+    uint8_t *p = out_reserve(c, H2_FRAME_HEADER_LEN + len);
+    if (p == NULL) {
+        return;
+    }
+    ssize_t got = 0;
+    while (got < len) {
+        ssize_t r = read(s->fd, p + H2_FRAME_HEADER_LEN + got, len - got);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            // 文件在发送过程中变短或者读出错，只能放弃这个流
+            perror("read file failed");
+            stream_error(c, s->id, H2_INTERNAL_ERROR);
+            return;
+        }
+        got += r;
+    }
+
+    s->remaining -= len;
+    s->window -= len;
+    c->send_window -= len;
+    int end = s->remaining == 0;
+    frame_header(p, len, H2_DATA, end ? H2_FLAG_END_STREAM : 0, s->id);
+    c->out_len += H2_FRAME_HEADER_LEN + len;
+    if (end) {
+        free_stream(c, s);
+    }
+}
+
+// 是否有流还有数据，并且流量控制窗口允许发送。
+// h2c 升级后等收到客户端的连接前言再发响应体：有的客户端在 101 之后收到大量数据时
+// 会先等响应而不发送前言，双方互相等待
+static int has_sendable(const struct h2_conn *c)
+{
+    if (c->preface == H2_WAIT_PREFACE || c->send_window <= 0) {
+        return 0;
+    }
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        const struct h2_stream *s = &c->streams[i];
+        if (s->id != 0 && s->state == H2_STREAM_SENDING && s->window > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 在输出缓冲区不太满时，轮流从每个可以发送的流取一帧，避免大文件占住连接
+static void produce_data(struct h2_conn *c)
+{
+    while (!c->failed && has_sendable(c) && out_pending(c) < H2_OUT_HIGH) {
+        int found = 0;
+        for (int k = 0; k < H2_MAX_STREAMS; k++) {
+            int i = (c->next + k) % H2_MAX_STREAMS;
+            struct h2_stream *s = &c->streams[i];
+            if (s->id != 0 && s->state == H2_STREAM_SENDING && s->window > 0) {
+                c->next = (i + 1) % H2_MAX_STREAMS;
+                send_data(c, s);
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+}
+
+static int name_is(const char *name, size_t name_len, const char *expected)
+{
+    return name_len == strlen(expected) && memcmp(name, expected, name_len) == 0;
+}
+
+static int on_header(void *arg, const char *name, size_t name_len, const char *value,
+                     size_t value_len)
+{
+    struct h2_request *req = (struct h2_request *)arg;
+    if (name_len == 0) {
+        req->error = 1;
+        return 0;
+    }
+
+    if (name[0] == ':') {
+        if (req->regular) {
+            req->error = 1;
+        } else if (name_is(name, name_len, ":method")) {
+            req->error |= req->has_method;
+            req->has_method = 1;
+            req->is_get = value_len == 3 && memcmp(value, "GET", 3) == 0;
+        } else if (name_is(name, name_len, ":scheme")) {
+            req->error |= req->has_scheme;
+            req->has_scheme = 1;
+        } else if (name_is(name, name_len, ":path")) {
+            req->error |= req->has_path || value_len == 0;
+            req->has_path = 1;
+            // 过长的路径不复制，交给 open_file 按长度拒绝
+            req->path_len = value_len;
+            if (value_len < sizeof(req->path)) {
+                memcpy(req->path, value, value_len);
+            }
+        } else if (!name_is(name, name_len, ":authority")) {
+            req->error = 1;
+        }
+        return 0;
+    }
+
+    req->regular = 1;
+    for (size_t i = 0; i < name_len; i++) {
+        if (name[i] >= 'A' && name[i] <= 'Z') {
+            req->error = 1;
+        }
+    }
+    // HTTP/2 中不允许出现针对单个连接的头部
+    if (name_is(name, name_len, "connection") || name_is(name, name_len, "keep-alive") ||
+        name_is(name, name_len, "proxy-connection") ||
+        name_is(name, name_len, "transfer-encoding") || name_is(name, name_len, "upgrade")) {
+        req->error = 1;
+    }
+    if (name_is(name, name_len, "te") &&
+        !(value_len == 8 && memcmp(value, "trailers", 8) == 0)) {
+        req->error = 1;
+    }
+    return 0;
+}
+
+// 一个完整的头部块已经收到
+static void handle_header_block(struct h2_conn *c, uint32_t id, int end_stream)
+{
+    struct h2_request req;
+    memset(&req, 0, sizeof(req));
+    if (hpack_decode(&c->decoder, c->block, c->block_len, on_header, &req) != 0) {
+        connection_error(c, H2_COMPRESSION_ERROR);
+        return;
+    }
+
+    struct h2_stream *s = find_stream(c, id);
+    if (s != NULL) {
+        // 请求体之后的 trailer，必须结束这个流
+        if (s->state != H2_STREAM_OPEN || !end_stream) {
+            stream_error(c, id, H2_PROTOCOL_ERROR);
+        } else {
+            respond(c, s);
+        }
+        return;
+    }
+
+    c->last_stream_id = id;
+    if (c->goaway) {
+        return;
+    }
+    if (req.error || !req.has_method || !req.has_scheme || !req.has_path) {
+        stream_error(c, id, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (c->active == H2_MAX_STREAMS) {
+        stream_error(c, id, H2_REFUSED_STREAM);
+        return;
+    }
+
+    s = find_stream(c, 0);
+    s->id = id;
+    s->state = H2_STREAM_OPEN;
+    s->is_get = req.is_get;
+    s->fd = -1;
+    s->window = c->peer_initial_window;
+    s->path_len = req.path_len;
+    memcpy(s->path, req.path, req.path_len < sizeof(s->path) ? req.path_len : 0);
+    c->active++;
+    if (end_stream) {
+        respond(c, s);
+    }
+}
+
+static void append_block(struct h2_conn *c, const uint8_t *p, size_t len)
+{
+    if (c->block_len + len > H2_MAX_HEADER_BLOCK) {
+        connection_error(c, H2_ENHANCE_YOUR_CALM);
+        return;
+    }
+    memcpy(c->block + c->block_len, p, len);
+    c->block_len += len;
+}
+
+// 去掉 PADDED 标志带来的填充，格式错误时返回 -1
+static int strip_padding(uint8_t flags, const uint8_t **p, size_t *len)
+{
+    if (!(flags & H2_FLAG_PADDED)) {
+        return 0;
+    }
+    if (*len < 1 || (*p)[0] >= *len) {
+        return -1;
+    }
+    *len -= 1 + (*p)[0];
+    (*p)++;
+    return 0;
+}
+
+static void handle_data(struct h2_conn *c, uint8_t flags, uint32_t id, const uint8_t *p,
+                        size_t len)
+{
+    if (id == 0) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    size_t frame_len = len;
+    if (strip_padding(flags, &p, &len) < 0) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    // 请求体直接丢弃，收到多少就把连接的接收窗口补回多少
+    if (frame_len > 0) {
+        send_u32(c, H2_WINDOW_UPDATE, 0, frame_len);
+    }
+
+    struct h2_stream *s = find_stream(c, id);
+    if (s == NULL) {
+        if (id > c->last_stream_id) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else {
+            send_u32(c, H2_RST_STREAM, id, H2_STREAM_CLOSED);
+        }
+        return;
+    }
+    if (s->state != H2_STREAM_OPEN) {
+        stream_error(c, id, H2_STREAM_CLOSED);
+        return;
+    }
+    if (flags & H2_FLAG_END_STREAM) {
+        respond(c, s);
+    } else if (frame_len > 0) {
+        send_u32(c, H2_WINDOW_UPDATE, id, frame_len);
+    }
+}
+
+static void handle_headers(struct h2_conn *c, uint8_t flags, uint32_t id, const uint8_t *p,
+                           size_t len)
+{
+    if (id == 0 || id % 2 == 0) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (strip_padding(flags, &p, &len) < 0) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (flags & H2_FLAG_PRIORITY) {
+        // 不按优先级调度，所有流平等地轮流发送，只跳过优先级字段
+        if (len < 5) {
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+            return;
+        }
+        p += 5;
+        len -= 5;
+    }
+    if (id <= c->last_stream_id && find_stream(c, id) == NULL) {
+        connection_error(c, H2_STREAM_CLOSED);
+        return;
+    }
+
+    c->block_len = 0;
+    append_block(c, p, len);
+    if (flags & H2_FLAG_END_HEADERS) {
+        handle_header_block(c, id, flags & H2_FLAG_END_STREAM);
+    } else {
+        c->block_stream = id;
+        c->block_end_stream = flags & H2_FLAG_END_STREAM;
+    }
+}
+
+static void handle_settings(struct h2_conn *c, uint8_t flags, uint32_t id, const uint8_t *p,
+                            size_t len)
+{
+    if (id != 0) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+    if (flags & H2_FLAG_ACK) {
+        if (len != 0) {
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+        }
+        return;
+    }
+    if (len % 6 != 0) {
+        connection_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+    uint32_t code = apply_settings(c, p, len);
+    if (code != 0) {
+        connection_error(c, code);
+        return;
+    }
+    send_frame(c, H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+    if (c->preface == H2_WAIT_SETTINGS) {
+        c->preface = H2_READY;
+    }
+}
+
+static void handle_window_update(struct h2_conn *c, uint32_t id, const uint8_t *p, size_t len)
+{
+    if (len != 4) {
+        connection_error(c, H2_FRAME_SIZE_ERROR);
+        return;
+    }
+    uint32_t inc = get_u32(p) & 0x7fffffff;
+    if (id == 0) {
+        c->send_window += inc;
+        if (inc == 0) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else if (c->send_window > H2_MAX_WINDOW) {
+            connection_error(c, H2_FLOW_CONTROL_ERROR);
+        }
+        return;
+    }
+
+    struct h2_stream *s = find_stream(c, id);
+    if (s == NULL) {
+        // 已经结束的流上迟到的 WINDOW_UPDATE 直接忽略
+        if (id > c->last_stream_id) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        }
+        return;
+    }
+    s->window += inc;
+    if (inc == 0) {
+        stream_error(c, id, H2_PROTOCOL_ERROR);
+    } else if (s->window > H2_MAX_WINDOW) {
+        stream_error(c, id, H2_FLOW_CONTROL_ERROR);
+    }
+}
+
+static void handle_frame(struct h2_conn *c, uint8_t type, uint8_t flags, uint32_t id,
+                         const uint8_t *p, size_t len)
+{
+    // 头部块没有收完时，中间不能插入其他帧
+    if (c->block_stream != 0) {
+        if (type != H2_CONTINUATION || id != c->block_stream) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+            return;
+        }
+        append_block(c, p, len);
+        if (!c->closing && (flags & H2_FLAG_END_HEADERS)) {
+            c->block_stream = 0;
+            handle_header_block(c, id, c->block_end_stream);
+        }
+        return;
+    }
+    // 连接前言之后的第一帧必须是 SETTINGS
+    if (c->preface == H2_WAIT_SETTINGS && type != H2_SETTINGS) {
+        connection_error(c, H2_PROTOCOL_ERROR);
+        return;
+    }
+
+    switch (type) {
+    case H2_DATA:
+        handle_data(c, flags, id, p, len);
+        break;
+    case H2_HEADERS:
+        handle_headers(c, flags, id, p, len);
+        break;
+    case H2_PRIORITY:
+        if (id == 0) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else if (len != 5) {
+            stream_error(c, id, H2_FRAME_SIZE_ERROR);
+        }
+        break;
+    case H2_RST_STREAM:
+        if (id == 0 || id > c->last_stream_id) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else if (len != 4) {
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+        } else {
+            struct h2_stream *s = find_stream(c, id);
+            if (s != NULL) {
+                free_stream(c, s);
+            }
+        }
+        break;
+    case H2_SETTINGS:
+        handle_settings(c, flags, id, p, len);
+        break;
+    case H2_PUSH_PROMISE:
+        // 客户端不能推送
+        connection_error(c, H2_PROTOCOL_ERROR);
+        break;
+    case H2_PING:
+        if (id != 0) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else if (len != 8) {
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+        } else if (!(flags & H2_FLAG_ACK)) {
+            send_frame(c, H2_PING, H2_FLAG_ACK, 0, p, len);
+        }
+        break;
+    case H2_GOAWAY:
+        if (id != 0) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+        } else if (len < 8) {
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+        } else {
+            c->goaway = 1;
+        }
+        break;
+    case H2_WINDOW_UPDATE:
+        handle_window_update(c, id, p, len);
+        break;
+    case H2_CONTINUATION:
+        // 前面没有未结束的 HEADERS
+        connection_error(c, H2_PROTOCOL_ERROR);
+        break;
+    default:
+        // 未知类型的帧必须忽略
+        break;
+    }
+}
+
+// 处理输入缓冲区中所有完整的帧
+static void process_input(struct h2_conn *c)
+{
+    size_t pos = 0;
+    if (c->preface == H2_WAIT_PREFACE) {
+        if (c->in_len < H2_PREFACE_LEN) {
+            return;
+        }
+        if (memcmp(c->in, H2_PREFACE, H2_PREFACE_LEN) != 0) {
+            connection_error(c, H2_PROTOCOL_ERROR);
+            return;
+        }
+        pos = H2_PREFACE_LEN;
+        c->preface = H2_WAIT_SETTINGS;
+    }
+
+    while (!c->closing && !c->failed && c->in_len - pos >= H2_FRAME_HEADER_LEN) {
+        const uint8_t *h = c->in + pos;
+        size_t len = (size_t)h[0] << 16 | h[1] << 8 | h[2];
+        if (len > H2_DEFAULT_FRAME_SIZE) {
+            // 没有通告更大的 SETTINGS_MAX_FRAME_SIZE
+            connection_error(c, H2_FRAME_SIZE_ERROR);
+            break;
+        }
+        if (c->in_len - pos < H2_FRAME_HEADER_LEN + len) {
+            break;
+        }
+        handle_frame(c, h[3], h[4], get_u32(h + 5) & 0x7fffffff, h + H2_FRAME_HEADER_LEN,
+                     len);
+        pos += H2_FRAME_HEADER_LEN + len;
+    }
+
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+}
+
+// 尽量写出输出缓冲区，写不下时留到下次可写时。对方已经关闭时返回 -1
+static int flush_output(struct h2_conn *c)
+{
+    while (out_pending(c) > 0) {
+        ssize_t n = send(c->sock, c->out + c->out_pos, out_pending(c), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            return -1;
+        }
+        c->out_pos += n;
+    }
+    c->out_pos = c->out_len = 0;
+    return 0;
+}
+
+static int read_input(struct h2_conn *c)
+{
+    if (c->in_len == c->in_cap) {
+        return 0; // process_input 总会取走完整的帧，这里只在帧没收完时发生
+    }
+    ssize_t n = read(c->sock, c->in + c->in_len, c->in_cap - c->in_len);
+    if (n < 0) {
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if (n == 0) {
+        c->peer_closed = 1;
+        return 0;
+    }
+    c->in_len += n;
+    return 0;
+}
+
+static int conn_init(struct h2_conn *c, int sock, const char *data, size_t len)
+{
+    memset(c, 0, sizeof(*c));
+    c->sock = sock;
+    c->send_window = H2_DEFAULT_WINDOW;
+    c->peer_initial_window = H2_DEFAULT_WINDOW;
+    c->peer_max_frame = H2_DEFAULT_FRAME_SIZE;
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        c->streams[i].fd = -1;
+    }
+
+    // 已经读到的数据可能比一个输入缓冲区还多
+    c->in_cap = len > H2_IN_BUF_SIZE ? len : H2_IN_BUF_SIZE;
+    c->in = (uint8_t *)malloc(c->in_cap);
+    c->out_cap = H2_OUT_HIGH + H2_DEFAULT_FRAME_SIZE + H2_FRAME_HEADER_LEN;
+    c->out = (uint8_t *)malloc(c->out_cap);
+    c->block = (uint8_t *)malloc(H2_MAX_HEADER_BLOCK);
+    if (c->in == NULL || c->out == NULL || c->block == NULL ||
+        hpack_table_init(&c->decoder, HPACK_DEFAULT_TABLE_SIZE) < 0) {
+        perror("h2 malloc failed");
+        return -1;
+    }
+    memcpy(c->in, data, len);
+    c->in_len = len;
+
+    // 响应都是很多小帧，关掉 Nagle 算法，写出时已经在缓冲区中合并过
+    int opt = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+static void conn_free(struct h2_conn *c)
+{
+    for (int i = 0; i < H2_MAX_STREAMS; i++) {
+        if (c->streams[i].id != 0) {
+            free_stream(c, &c->streams[i]);
+        }
+    }
+    if (c->decoder.entries != NULL) {
+        hpack_table_free(&c->decoder);
+    }
+    free(c->in);
+    free(c->out);
+    free(c->block);
+}
+
+static void conn_run(struct h2_conn *c)
+{
+    process_input(c);
+    while (!c->failed) {
+        if (!c->closing) {
+            produce_data(c);
+        }
+        if (flush_output(c) < 0) {
+            break;
+        }
+        // 对方关闭写端后不会再有 WINDOW_UPDATE，能发的都发完就结束
+        size_t pending = out_pending(c);
+        if (pending == 0 && (c->closing || (c->peer_closed && !has_sendable(c)) ||
+                             (c->goaway && c->active == 0))) {
+            break;
+        }
+
+        struct pollfd pfd = {c->sock, 0, 0};
+        // 对方不读响应时也不再读它的请求，避免输出缓冲区无限增长
+        if (!c->closing && !c->peer_closed && pending < 4 * H2_OUT_HIGH) {
+            pfd.events |= POLLIN;
+        }
+        // 缓冲区写空了但还有可以发送的数据时也等待可写，下一轮继续从文件读
+        if (pending > 0 || (!c->closing && has_sendable(c))) {
+            pfd.events |= POLLOUT;
+        }
+        int timeout = c->active == 0 && pending == 0 ? H2_IDLE_TIMEOUT_MS : -1;
+        int n = poll(&pfd, 1, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (n == 0) {
+            connection_error(c, H2_NO_ERROR);
+            continue;
+        }
+        if (n > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            if (read_input(c) < 0) {
+                break;
+            }
+            process_input(c);
+        }
+    }
+}
+
+// 解码 HTTP2-Settings 头部中 base64url 编码的 SETTINGS 内容
+static ssize_t base64url_decode(uint8_t *out, const char *in, size_t len)
+{
+    ssize_t n = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        char ch = in[i];
+        int v;
+        if (ch >= 'A' && ch <= 'Z') {
+            v = ch - 'A';
+        } else if (ch >= 'a' && ch <= 'z') {
+            v = ch - 'a' + 26;
+        } else if (ch >= '0' && ch <= '9') {
+            v = ch - '0' + 52;
+        } else if (ch == '-') {
+            v = 62;
+        } else if (ch == '_') {
+            v = 63;
+        } else if (ch == '=') {
+            break;
+        } else {
+            return -1;
+        }
+        acc = acc << 6 | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out[n++] = (uint8_t)(acc >> bits);
+        }
+    }
+    return n;
+}
+
+// 在请求头中查找名为 name 的头部（不区分大小写），返回值的起始位置并去掉首尾空白
+static const char *find_header(const char *req, size_t header_len, const char *name,
+                               size_t *value_len)
+{
+    size_t name_len = strlen(name);
+    const char *end = req + header_len;
+    const char *line = memmem(req, header_len, "\r\n", 2);
+    while (line != NULL && line + 2 < end) {
+        line += 2;
+        const char *eol = memmem(line, end - line, "\r\n", 2);
+        if (eol == NULL) {
+            break;
+        }
+        if ((size_t)(eol - line) > name_len && line[name_len] == ':' &&
+            strncasecmp(line, name, name_len) == 0) {
+            const char *v = line + name_len + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) {
+                v++;
+            }
+            const char *v_end = eol;
+            while (v_end > v && (v_end[-1] == ' ' || v_end[-1] == '\t')) {
+                v_end--;
+            }
+            *value_len = v_end - v;
+            return v;
+        }
+        line = eol;
+    }
+    return NULL;
+}
+
+// 逗号分隔的列表中是否有 token（不区分大小写）
+static int has_token(const char *list, size_t len, const char *token)
+{
+    size_t token_len = strlen(token);
+    const char *end = list + len;
+    while (list < end) {
+        while (list < end && (*list == ' ' || *list == ',')) {
+            list++;
+        }
+        const char *item = list;
+        while (list < end && *list != ',' && *list != ' ') {
+            list++;
+        }
+        if ((size_t)(list - item) == token_len && strncasecmp(item, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int serve_upgrade(int sock, char *req, size_t header_len, size_t req_len)
+{
+    // 只升级没有请求体的 HTTP/1.1 GET 请求
+    char *path_start = req + 4;
+    char *path_end = memchr(path_start, ' ', header_len - 4);
+    if (strncmp(req, "GET ", 4) != 0 || path_end == NULL ||
+        strncmp(path_end, " HTTP/1.1\r\n", 11) != 0) {
+        return 0;
+    }
+    size_t upgrade_len, settings_len, body_len;
+    const char *upgrade = find_header(req, header_len, "upgrade", &upgrade_len);
+    const char *settings = find_header(req, header_len, "http2-settings", &settings_len);
+    const char *body = find_header(req, header_len, "content-length", &body_len);
+    if (upgrade == NULL || settings == NULL || !has_token(upgrade, upgrade_len, "h2c") ||
+        (body != NULL && !(body_len == 1 && body[0] == '0'))) {
+        return 0;
+    }
+    uint8_t payload[256];
+    ssize_t payload_len = settings_len / 4 * 3 + 3 <= sizeof(payload)
+                              ? base64url_decode(payload, settings, settings_len)
+                              : -1;
+    if (payload_len < 0 || payload_len % 6 != 0) {
+        return 0;
+    }
+
+    struct h2_conn *c = (struct h2_conn *)malloc(sizeof(struct h2_conn));
+    if (c == NULL || conn_init(c, sock, req + header_len, req_len - header_len) < 0 ||
+        apply_settings(c, payload, payload_len) != 0) {
+        // 已经读走了请求，无法再按 HTTP/1.0 处理，直接关闭连接
+        if (c != NULL) {
+            conn_free(c);
+            free(c);
+        }
+        return 1;
+    }
+
+    // 101 之后是服务器的连接前言，然后在流 1 上回复升级前的请求
+    static const char switching[] =
+        "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    memcpy(c->out, switching, sizeof(switching) - 1);
+    c->out_len = sizeof(switching) - 1;
+    send_settings(c);
+
+    struct h2_stream *s = &c->streams[0];
+    s->id = 1;
+    s->is_get = 1;
+    s->window = c->peer_initial_window;
+    s->path_len = path_end - path_start;
+    memcpy(s->path, path_start, s->path_len < sizeof(s->path) ? s->path_len : 0);
+    c->active = 1;
+    c->last_stream_id = 1;
+    respond(c, s);
+
+    conn_run(c);
+    conn_free(c);
+    free(c);
+    return 1;
+}
+
+int h2_handle(int sock, char *req, size_t header_len, size_t req_len)
+{
+    // read_request 读到连接前言中的第一个空行就停下，这里只比较到空行为止，其余部分在 conn_run 中检查
+    if (header_len == 18 && memcmp(req, H2_PREFACE, 18) == 0) {
+        struct h2_conn *c = (struct h2_conn *)malloc(sizeof(struct h2_conn));
+        if (c != NULL && conn_init(c, sock, req, req_len) == 0) {
+            send_settings(c);
+            conn_run(c);
+        }
+        if (c != NULL) {
+            conn_free(c);
+            free(c);
+        }
+        return 1;
+    }
+    return serve_upgrade(sock, req, header_len, req_len);
+}
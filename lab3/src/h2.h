@@ -0,0 +1,15 @@
+#ifndef H2_H
+#define H2_H
+
+#include <stddef.h>
+
+// 明文 HTTP/2（h2c）。一个连接上可以同时有多个请求（流），
+// 响应体按流轮流发送，每次一帧，受流和连接两级流量控制的限制。
+// 文件的查找和打开与 HTTP/1.0 共用 open_file。
+
+// req 是 read_request 读到的数据，共 req_len 字节，其中请求头占前 header_len 字节。
+// 如果它以 HTTP/2 连接前言开头（prior knowledge），或者是带 Upgrade: h2c 的 HTTP/1.1 请求，
+// 就在这个连接上提供 HTTP/2 服务直到连接结束，返回 1；否则什么都不做，返回 0
+int h2_handle(int sock, char *req, size_t header_len, size_t req_len);
+
+#endif // H2_H
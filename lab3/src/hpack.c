@@ -0,0 +1,460 @@
+// hpack.c
+#include "hpack.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *name, *value;
+} static_table[HPACK_STATIC_COUNT + 1] = {
+    {NULL, NULL},
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+// RFC 7541 附录 B 中每个符号的码长，256 是 EOS。
+// 这个 Huffman 编码是规范的：码字按 (码长, 符号) 的顺序依次分配，因此只存码长即可
+static const uint8_t huffman_len[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+#define HUFFMAN_MAX_LEN 30
+#define HUFFMAN_EOS 256
+
+// 由码长生成的编码表和解码表
+static struct {
+    uint32_t code[257];                  // 每个符号的码字
+    uint16_t count[HUFFMAN_MAX_LEN + 1]; // 每种码长的码字个数
+    uint16_t sym[257];                   // 按 (码长, 符号) 排序的符号
+} huffman;
+
+static pthread_once_t huffman_once = PTHREAD_ONCE_INIT;
+
+static void huffman_build(void)
+{
+    uint16_t offset[HUFFMAN_MAX_LEN + 2];
+    for (int s = 0; s <= HUFFMAN_EOS; s++) {
+        huffman.count[huffman_len[s]]++;
+    }
+    offset[1] = 0;
+    for (int len = 1; len <= HUFFMAN_MAX_LEN; len++) {
+        offset[len + 1] = offset[len] + huffman.count[len];
+    }
+    for (int s = 0; s <= HUFFMAN_EOS; s++) {
+        huffman.sym[offset[huffman_len[s]]++] = s;
+    }
+
+    uint32_t code = 0;
+    int len = 1;
+    for (int i = 0; i <= HUFFMAN_EOS; i++) {
+        int s = huffman.sym[i];
+        code <<= huffman_len[s] - len;
+        len = huffman_len[s];
+        huffman.code[s] = code++;
+    }
+}
+
+ssize_t hpack_huffman_decode(char *out, const uint8_t *in, size_t len)
+{
+    pthread_once(&huffman_once, huffman_build);
+
+    // 逐位解码规范 Huffman 码：code 是当前读到的位，first 是当前码长的第一个码字，
+    // index 是当前码长的第一个符号在 huffman.sym 中的位置
+    ssize_t n = 0;
+    uint32_t code = 0, first = 0, index = 0;
+    int bits = 0, all_ones = 1;
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 7; b >= 0; b--) {
+            int bit = (in[i] >> b) & 1;
+            code |= bit;
+            all_ones &= bit;
+            bits++;
+            uint32_t count = huffman.count[bits];
+            if (code - first < count) {
+                int s = huffman.sym[index + code - first];
+                if (s == HUFFMAN_EOS) {
+                    return -1;
+                }
+                out[n++] = (char)s;
+                code = first = index = 0;
+                bits = 0;
+                all_ones = 1;
+                continue;
+            }
+            if (bits == HUFFMAN_MAX_LEN) {
+                return -1;
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+    }
+    // 末尾的填充不超过 7 位，且必须是 EOS 的前缀（全为 1）
+    if (bits > 7 || !all_ones) {
+        return -1;
+    }
+    return n;
+}
+
+static size_t huffman_encoded_len(const char *s, size_t len)
+{
+    size_t bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        bits += huffman_len[(uint8_t)s[i]];
+    }
+    return (bits + 7) / 8;
+}
+
+static size_t huffman_encode(uint8_t *out, const char *s, size_t len)
+{
+    size_t n = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)s[i];
+        acc = (acc << huffman_len[c]) | huffman.code[c];
+        bits += huffman_len[c];
+        while (bits >= 8) {
+            bits -= 8;
+            out[n++] = (uint8_t)(acc >> bits);
+        }
+    }
+    if (bits > 0) {
+        // 用 EOS 的高位（全 1）填充最后一个字节
+        out[n++] = (uint8_t)((acc << (8 - bits)) | (0xff >> bits));
+    }
+    return n;
+}
+
+size_t hpack_encode_int(uint8_t *out, uint8_t first, int prefix_bits, uint64_t value)
+{
+    uint64_t max = (1u << prefix_bits) - 1;
+    if (value < max) {
+        out[0] = first | (uint8_t)value;
+        return 1;
+    }
+    size_t n = 0;
+    out[n++] = first | (uint8_t)max;
+    value -= max;
+    while (value >= 128) {
+        out[n++] = (uint8_t)(value % 128 + 128);
+        value /= 128;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+size_t hpack_encode_string(uint8_t *out, const char *s, size_t len)
+{
+    pthread_once(&huffman_once, huffman_build);
+
+    size_t huff_len = huffman_encoded_len(s, len);
+    if (huff_len < len) {
+        size_t n = hpack_encode_int(out, 0x80, 7, huff_len);
+        return n + huffman_encode(out + n, s, len);
+    }
+    size_t n = hpack_encode_int(out, 0, 7, len);
+    memcpy(out + n, s, len);
+    return n + len;
+}
+
+size_t hpack_encode_indexed(uint8_t *out, unsigned index)
+{
+    return hpack_encode_int(out, 0x80, 7, index);
+}
+
+size_t hpack_encode_literal(uint8_t *out, unsigned name_index, const char *value,
+                            size_t len)
+{
+    // 不加入动态表的字面量：0000 加 4 位前缀的名字下标
+    size_t n = hpack_encode_int(out, 0x00, 4, name_index);
+    return n + hpack_encode_string(out + n, value, len);
+}
+
+size_t hpack_encode_literal_incremental(uint8_t *out, unsigned name_index,
+                                        const char *value, size_t len)
+{
+    // 加入动态表的字面量：01 加 6 位前缀的名字下标
+    size_t n = hpack_encode_int(out, 0x40, 6, name_index);
+    return n + hpack_encode_string(out + n, value, len);
+}
+
+int hpack_table_init(struct hpack_table *t, size_t limit)
+{
+    // 每项至少占 32 字节，所以表中最多有 limit / 32 项
+    t->cap = limit / 32 + 1;
+    t->entries = (struct hpack_entry *)calloc(t->cap, sizeof(struct hpack_entry));
+    t->count = t->head = t->size = 0;
+    t->max_size = t->limit = limit;
+    return t->entries == NULL ? -1 : 0;
+}
+
+static void table_evict(struct hpack_table *t, size_t max_size)
+{
+    while (t->size > max_size) {
+        struct hpack_entry *e = &t->entries[(t->head + t->count - 1) % t->cap];
+        t->size -= e->name_len + e->value_len + 32;
+        free(e->name);
+        e->name = e->value = NULL;
+        t->count--;
+    }
+}
+
+void hpack_table_free(struct hpack_table *t)
+{
+    table_evict(t, 0);
+    free(t->entries);
+    t->entries = NULL;
+}
+
+// 加入动态表。name 可能指向表中即将被淘汰的项，所以先复制再淘汰
+static int table_add(struct hpack_table *t, const char *name, size_t name_len,
+                     const char *value, size_t value_len)
+{
+    size_t size = name_len + value_len + 32;
+    if (size > t->max_size) {
+        // 比整张表还大的项：清空动态表，不加入
+        table_evict(t, 0);
+        return 0;
+    }
+    char *block = (char *)malloc(name_len + value_len + 1);
+    if (block == NULL) {
+        return -1;
+    }
+    memcpy(block, name, name_len);
+    memcpy(block + name_len, value, value_len);
+    table_evict(t, t->max_size - size);
+
+    t->head = (t->head + t->cap - 1) % t->cap;
+    struct hpack_entry *e = &t->entries[t->head];
+    e->name = block;
+    e->name_len = name_len;
+    e->value = block + name_len;
+    e->value_len = value_len;
+    t->count++;
+    t->size += size;
+    return 0;
+}
+
+// 按下标查找，1 到 61 在静态表中，之后是动态表（62 是最新加入的一项）
+static int table_get(const struct hpack_table *t, uint64_t index, const char **name,
+                     size_t *name_len, const char **value, size_t *value_len)
+{
+    if (index == 0) {
+        return -1;
+    }
+    if (index <= HPACK_STATIC_COUNT) {
+        *name = static_table[index].name;
+        *name_len = strlen(*name);
+        *value = static_table[index].value;
+        *value_len = strlen(*value);
+        return 0;
+    }
+    index -= HPACK_STATIC_COUNT + 1;
+    if (index >= t->count) {
+        return -1;
+    }
+    const struct hpack_entry *e = &t->entries[(t->head + index) % t->cap];
+    *name = e->name;
+    *name_len = e->name_len;
+    *value = e->value;
+    *value_len = e->value_len;
+    return 0;
+}
+
+static int decode_int(const uint8_t **p, const uint8_t *end, int prefix_bits,
+                      uint64_t *value)
+{
+    uint64_t max = (1u << prefix_bits) - 1;
+    *value = **p & max;
+    (*p)++;
+    if (*value < max) {
+        return 0;
+    }
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (*p == end) {
+            return -1;
+        }
+        uint8_t b = *(*p)++;
+        *value += (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return 0;
+        }
+    }
+    return -1; // 超过 32 位的整数视为错误
+}
+
+// 解码一个字符串字面量。原样存储时直接指向输入，Huffman 编码时解码到 *scratch 并后移
+static int decode_string(const uint8_t **p, const uint8_t *end, char **scratch,
+                         const char **s, size_t *len)
+{
+    if (*p == end) {
+        return -1;
+    }
+    int huff = **p & 0x80;
+    uint64_t n;
+    if (decode_int(p, end, 7, &n) < 0 || n > (uint64_t)(end - *p)) {
+        return -1;
+    }
+    if (!huff) {
+        *s = (const char *)*p;
+        *len = n;
+    } else {
+        ssize_t r = hpack_huffman_decode(*scratch, *p, n);
+        if (r < 0) {
+            return -1;
+        }
+        *s = *scratch;
+        *len = r;
+        *scratch += r;
+    }
+    *p += n;
+    return 0;
+}
+
+int hpack_decode(struct hpack_table *t, const uint8_t *in, size_t len,
+                 hpack_header_cb cb, void *arg)
+{
+    // Huffman 码最短 5 位，解码后的字符串总长不超过 len * 8 / 5
+    char *scratch = (char *)malloc(len * 8 / 5 + 1);
+    if (scratch == NULL) {
+        return -1;
+    }
+
+    const uint8_t *p = in, *end = in + len;
+    int headers = 0, ret = 0;
+    while (p < end && ret == 0) {
+        char *next = scratch;
+        const char *name, *value;
+        size_t name_len, value_len;
+        uint64_t index;
+        uint8_t b = *p;
+
+        if (b & 0x80) {
+            // 完整的头部在表中
+            if (decode_int(&p, end, 7, &index) < 0 ||
+                table_get(t, index, &name, &name_len, &value, &value_len) < 0) {
+                ret = -1;
+                break;
+            }
+            ret = cb(arg, name, name_len, value, value_len);
+            headers++;
+            continue;
+        }
+
+        if ((b & 0xe0) == 0x20) {
+            // 动态表大小更新，只能出现在头部块开头
+            if (headers > 0 || decode_int(&p, end, 5, &index) < 0 || index > t->limit) {
+                ret = -1;
+                break;
+            }
+            t->max_size = index;
+            table_evict(t, t->max_size);
+            continue;
+        }
+
+        // 字面量：01 加入动态表，0000 不加入，0001 永不加入
+        int incremental = (b & 0xc0) == 0x40;
+        if (decode_int(&p, end, incremental ? 6 : 4, &index) < 0) {
+            ret = -1;
+            break;
+        }
+        if (index == 0) {
+            if (decode_string(&p, end, &next, &name, &name_len) < 0) {
+                ret = -1;
+                break;
+            }
+        } else if (table_get(t, index, &name, &name_len, &value, &value_len) < 0) {
+            ret = -1;
+            break;
+        }
+        if (decode_string(&p, end, &next, &value, &value_len) < 0) {
+            ret = -1;
+            break;
+        }
+        ret = cb(arg, name, name_len, value, value_len);
+        headers++;
+        if (incremental && table_add(t, name, name_len, value, value_len) < 0) {
+            ret = -1;
+        }
+    }
+
+    free(scratch);
+    return ret;
+}
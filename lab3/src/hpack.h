@@ -0,0 +1,73 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// HPACK（RFC 7541）头部压缩。
+// 解码支持动态表和 Huffman 编码。编码只提供基本的表示方法，不维护动态表：
+// 服务器的响应头只用静态表和不加入动态表的字面量，对方的 SETTINGS_HEADER_TABLE_SIZE 不影响它。
+
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+#define HPACK_STATIC_COUNT 61
+
+// 常用的静态表下标
+#define HPACK_AUTHORITY 1
+#define HPACK_ACCEPT 19
+#define HPACK_USER_AGENT 58
+#define HPACK_METHOD_GET 2
+#define HPACK_PATH 4
+#define HPACK_SCHEME_HTTP 6
+#define HPACK_STATUS_200 8 // 其他状态码用这一项的名字加字面量
+#define HPACK_STATUS_404 13
+#define HPACK_STATUS_500 14
+#define HPACK_CONTENT_LENGTH 28
+
+struct hpack_entry {
+    char *name; // name 和 value 在同一块内存中，释放 name 即可
+    char *value;
+    size_t name_len, value_len;
+};
+
+// 解码端的动态表。环形数组，entries[head] 是最新加入的一项
+struct hpack_table {
+    struct hpack_entry *entries;
+    size_t cap, count, head;
+    size_t size;     // 当前大小，每项为名字和值的长度之和加 32
+    size_t max_size; // 当前上限，编码端可以用动态表大小更新指令调小
+    size_t limit;    // max_size 不能超过的值，即本端通告的 SETTINGS_HEADER_TABLE_SIZE
+};
+
+// 每解码出一个头部调用一次，返回非 0 时停止解码
+typedef int (*hpack_header_cb)(void *arg, const char *name, size_t name_len,
+                               const char *value, size_t value_len);
+
+int hpack_table_init(struct hpack_table *t, size_t limit);
+void hpack_table_free(struct hpack_table *t);
+
+// 解码一个完整的头部块。成功返回 0，cb 返回非 0 时原样返回该值，
+// 头部块格式错误返回 -1（对应 HTTP/2 的 COMPRESSION_ERROR，此后动态表不再可用）
+int hpack_decode(struct hpack_table *t, const uint8_t *in, size_t len,
+                 hpack_header_cb cb, void *arg);
+
+// 以下编码函数都返回写入 out 的字节数
+
+// 前缀为 prefix_bits 位的整数，first 是第一个字节中前缀以外的标志位
+size_t hpack_encode_int(uint8_t *out, uint8_t first, int prefix_bits, uint64_t value);
+// 字符串字面量，Huffman 编码更短时使用 Huffman 编码。out 至少要有 len + 10 字节
+size_t hpack_encode_string(uint8_t *out, const char *s, size_t len);
+// 表中的完整头部，如 HPACK_METHOD_GET
+size_t hpack_encode_indexed(uint8_t *out, unsigned index);
+// 名字取静态表第 name_index 项，值为字面量，不加入对方的动态表
+size_t hpack_encode_literal(uint8_t *out, unsigned name_index, const char *value,
+                            size_t len);
+// 同上，但让对方把这个头部加入动态表，之后可以用 hpack_encode_indexed 引用。
+// 调用者需要自己按对方的表大小跟踪下标
+size_t hpack_encode_literal_incremental(uint8_t *out, unsigned name_index,
+                                        const char *value, size_t len);
+
+// Huffman 解码，成功返回解码后的长度，编码错误返回 -1。out 至少要有 len * 8 / 5 字节
+ssize_t hpack_huffman_decode(char *out, const uint8_t *in, size_t len);
+
+#endif // HPACK_H
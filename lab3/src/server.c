@@ -1,48 +1,49 @@
 // server.c
+#define _GNU_SOURCE
 #include "server.h"
 #include "thread.h"
+#include "h2.h"
 
-int parse_request(int client_socket, ssize_t *req_len, char *req, struct stat *file_type)
+// 不断尝试读取，直到读取到两个换行符（\r\n\r\n）时才算读取完成。
+// 返回读到的字节数（可能包含请求头之后的数据），header_len 为请求头（含空行）的长度
+ssize_t read_request(int client_socket, char *req, size_t *header_len)
 {
-    char *buf = (char *)malloc(MAX_RECV_LEN * sizeof(char));
-    ssize_t buf_len = 0;
+    ssize_t req_len = 0;
     char *end_of_header = NULL;
 
-    // 不断尝试读取，直到读取到两个换行符（\r\n\r\n）时才算读取完成
-    while ((end_of_header = strstr(buf, "\r\n\r\n")) == NULL) {
-        buf_len = read(client_socket, buf + *req_len, MAX_RECV_LEN - *req_len - 1);
+    while ((end_of_header = memmem(req, req_len, "\r\n\r\n", 4)) == NULL) {
+        if (req_len == MAX_RECV_LEN - 1) {
+            perror("Request header too long");
+            return -1;
+        }
+        ssize_t buf_len = read(client_socket, req + req_len, MAX_RECV_LEN - req_len - 1);
         if (buf_len < 0) {
             perror("read");
-            free(buf);
             return -1;
         }
-        *req_len += buf_len;
-        buf[*req_len] = '\0';
+        if (buf_len == 0) {
+            // 请求头还没有结束，客户端就关闭了连接
+            return -1;
+        }
+        req_len += buf_len;
     }
+    req[req_len] = '\0';
 
-    // 将 buf 的内容复制到 req 中
-    strncpy(req, buf, *req_len);
-    req[*req_len] = '\0';
-
-    // 验证请求的有效性
-    if (strncmp(buf, "GET ", 4) != 0) {
-        perror("Invalid request");
-        free(buf);
-        return ERR_INVALID_METHOD;
-    }
+    *header_len = end_of_header + 4 - req;
+    return req_len;
+}
 
-    // 解析请求的路径
-    char *path_start = buf + 4; // 跳过 "GET "
-    char *path_end = strchr(path_start, ' ');
-    if (path_end == NULL) {
-        perror("Invalid request");
-        free(buf);
+// 把请求的路径映射为当前目录下的文件并打开，HTTP/1.0 和 HTTP/2 共用。
+// 成功时返回文件描述符，并把文件的状态信息存入 file_type
+int open_file(const char *uri, size_t path_len, struct stat *file_type)
+{
+    if (path_len + 2 > MAX_PATH_LEN) {
+        perror("Path too long");
         return -1;
     }
-    size_t path_len = path_end - path_start;
     char path[MAX_PATH_LEN];
     path[0] = '.'; // 在路径首位插入一个 '.'
-    strncpy(path + 1, path_start, path_len); // 将路径复制到 path 中，从第二个字符开始
+    memcpy(path + 1, uri, path_len); // 将路径复制到 path 中，从第二个字符开始
     //去掉末尾的"/"
     if (path[path_len] == '/' && path_len > 1) {
         path_len--;
@@ -52,7 +53,6 @@ int parse_request(int client_socket, ssize_t *req_len, char *req, struct stat *f
     // 检查路径是否试图访问当前目录之外的文件
     if (strstr(path, "../") != NULL || strstr(path, "..\\") != NULL) {
         perror("Path traversal attempt");
-        free(buf);
         return -1;
     }
 
@@ -60,13 +60,11 @@ int parse_request(int client_socket, ssize_t *req_len, char *req, struct stat *f
     int file_fd = open(path, O_RDONLY);
     if (file_fd < 0) {
         perror("open");
-        free(buf);
         return ERR_NOT_FOUND;
     }
     if (fstat(file_fd, file_type) < 0) {
         perror("fstat");
         close(file_fd);
-        free(buf);
         return -1;
     }
 
@@ -74,14 +72,31 @@ int parse_request(int client_socket, ssize_t *req_len, char *req, struct stat *f
     if (S_ISDIR(file_type->st_mode)) {
         perror("Requested resource is a directory");
         close(file_fd);
-        free(buf);
         return -1;
     }
 
-    free(buf);
     return file_fd;
 }
 
+int parse_request(char *req, struct stat *file_type)
+{
+    // 验证请求的有效性
+    if (strncmp(req, "GET ", 4) != 0) {
+        perror("Invalid request");
+        return ERR_INVALID_METHOD;
+    }
+
+    // 解析请求的路径
+    char *path_start = req + 4; // 跳过 "GET "
+    char *path_end = strchr(path_start, ' ');
+    if (path_end == NULL) {
+        perror("Invalid request");
+        return -1;
+    }
+
+    return open_file(path_start, path_end - path_start, file_type);
+}
+
 void handle_clnt(int clnt_sock)
 {
     // 读取客户端发送来的数据，并解析
@@ -93,9 +108,18 @@ void handle_clnt(int clnt_sock)
     }
     req[0] = '\0';
 
-    ssize_t req_len = 0;
+    size_t header_len = 0;
+    ssize_t req_len = read_request(clnt_sock, req, &header_len);
+
+    // HTTP/2 连接（prior knowledge 或者 h2c 升级）在 h2_handle 中处理到连接结束
+    if (req_len >= 0 && h2_handle(clnt_sock, req, header_len, req_len)) {
+        close(clnt_sock);
+        free(req);
+        return;
+    }
+
     struct stat file_type;
-    int file_fd = parse_request(clnt_sock, &req_len, req, &file_type);
+    int file_fd = req_len < 0 ? -1 : parse_request(req, &file_type);
 
     if (file_fd == ERR_INVALID_METHOD) {
         // 请求方法无效，发送错误响应
@@ -26,6 +26,8 @@
 #define ERR_INVALID_METHOD -2
 #define ERR_NOT_FOUND -3
 
-int parse_request(int client_socket, ssize_t *req_len, char *req, struct stat *file_type);
+ssize_t read_request(int client_socket, char *req, size_t *header_len);
+int open_file(const char *uri, size_t path_len, struct stat *file_type);
+int parse_request(char *req, struct stat *file_type);
 
 void handle_clnt(int clnt_sock);
\ No newline at end of file